@@ -3,6 +3,10 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aColor;
+layout (location = 4) in vec3 aOffset;
+layout (location = 5) in uvec4 aCell;
+layout (location = 6) in uint aCube;
+layout (location = 8) in uint aFaces;
 
 out vec3 FragPos;
 out vec2 TexCoords;
@@ -12,14 +16,46 @@ out mat3 TBN;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+uniform int instanced;
+uniform vec3 palette[7];
+// Instanced cubies: orientation aCell.w, grid cell aCell.xyz of an n x n x n cube, and the
+// cube's turn in progress from animState (axis or -1, then one angle per layer).
+uniform mat3 orientations[24];
+uniform samplerBuffer animState;
+uniform int cubeSize;
+
+vec3 turn(vec3 p, int axis, float angle)
+{
+    int b = (axis + 1) % 3, c = (axis + 2) % 3;
+    float s = sin(angle), k = cos(angle);
+    vec3 r = p;
+    r[b] = k * p[b] - s * p[c];
+    r[c] = s * p[b] + k * p[c];
+    return r;
+}
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 N;
+    if(instanced == 1) {
+        float k = 3.0 / float(cubeSize);
+        mat3 R = orientations[aCell.w];
+        vec3 p = (vec3(aCell.xyz) - 0.5 * float(cubeSize - 1) + R * aPos * 0.95) * k;
+        N = R * aNormal;
+        vec4 anim = texelFetch(animState, int(aCube));
+        int axis = int(anim.x);
+        if(axis >= 0) {
+            float angle = anim[1 + int(aCell[axis])];
+            if(angle != 0.0) { p = turn(p, axis, angle); N = turn(N, axis, angle); }
+        }
+        FragPos = p + aOffset;
+        FaceColor = palette[(aFaces >> uint(3 * (gl_VertexID / 6))) & 7u];
+    } else {
+        FragPos = vec3(model * vec4(aPos, 1.0));
+        FaceColor = aColor;
+        N = normalize(vec3(model * vec4(aNormal, 0.0)));
+    }
     TexCoords = aTexCoords;
-    FaceColor = aColor;
-
-    vec3 N = normalize(vec3(model * vec4(aNormal, 0.0)));
 
 
     vec3 up = abs(N.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
@@ -0,0 +1,61 @@
+#version 330 core
+// One instance per sticker of face (axis*2 + side): instance u*n + v sits at grid cell (u, v)
+// along the axes after axis. Outputs match cube.vert so cube.frag shades it.
+out vec3 FragPos;
+out vec2 TexCoords;
+out vec3 FaceColor;
+out mat3 TBN;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform int n;
+uniform int face;
+uniform float scale;
+uniform float gap;
+uniform int animAxis;
+uniform sampler2D layerAngles;   // 1 x n, radians
+uniform usampler2D stickers;
+uniform vec3 palette[7];
+
+const vec2 corners[6] = vec2[](vec2(0, 0), vec2(1, 0), vec2(1, 1), vec2(1, 1), vec2(0, 1), vec2(0, 0));
+
+vec3 turn(vec3 p, int axis, float angle)
+{
+    int b = (axis + 1) % 3, c = (axis + 2) % 3;
+    float s = sin(angle), k = cos(angle);
+    vec3 r = p;
+    r[b] = k * p[b] - s * p[c];
+    r[c] = s * p[b] + k * p[c];
+    return r;
+}
+
+void main()
+{
+    int a = face / 2, side = face % 2, b = (a + 1) % 3, c = (a + 2) % 3;
+    int u = gl_InstanceID / n, v = gl_InstanceID % n;
+    vec2 q = corners[gl_VertexID];
+
+    vec3 p = vec3(0.0), N = vec3(0.0);
+    p[a] = float(side * n);
+    p[b] = float(u) + gap + (1.0 - 2.0 * gap) * q.x;
+    p[c] = float(v) + gap + (1.0 - 2.0 * gap) * q.y;
+    p -= 0.5 * float(n);
+    N[a] = side == 1 ? 1.0 : -1.0;
+
+    if(animAxis >= 0) {
+        int layer = animAxis == a ? side * (n - 1) : animAxis == b ? u : v;
+        float angle = texelFetch(layerAngles, ivec2(layer, 0), 0).r;
+        if(angle != 0.0) { p = turn(p, animAxis, angle); N = turn(N, animAxis, angle); }
+    }
+
+    FragPos = p * scale;
+    TexCoords = q;
+    FaceColor = palette[texelFetch(stickers, ivec2(v, face * n + u), 0).r];
+
+    vec3 up = abs(N.y) < 0.999 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0);
+    vec3 T = normalize(cross(up, N));
+    vec3 B = cross(N, T);
+    TBN = mat3(T, B, N);
+
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 330 core
+out vec4 FragColor;
+in vec2 TexCoords;
+in vec4 Color;
+
+uniform sampler2D atlas;
+
+void main()
+{
+    float d = texture(atlas, TexCoords).r;
+    float w = max(fwidth(d), 0.02);
+    float a = smoothstep(0.5 - w, 0.5 + w, d);
+    FragColor = vec4(Color.rgb, Color.a * a);
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "audio.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include "miniaudio.h"
+
+static ma_engine engine; static ma_context null_context;
+static int engine_ok = 0, null_backend = 0;
+static pthread_t init_thread; static pthread_mutex_t init_lock = PTHREAD_MUTEX_INITIALIZER;
+static int init_pending = 0, init_result = 0, live = 0;
+static char sound_path[512];
+
+static void* pcm = NULL; static ma_uint64 pcm_frames = 0;
+static ma_audio_buffer_ref sources[AUDIO_VOICES];
+static ma_sound voices[AUDIO_VOICES]; static unsigned int voice_started[AUDIO_VOICES];
+static int voice_count = 0, started_this_frame = 0; static unsigned int play_counter = 0;
+
+static int load_voices(const char* path) {
+    ma_uint32 channels = ma_engine_get_channels(&engine);
+    ma_decoder_config cfg = ma_decoder_config_init(ma_format_f32, channels, ma_engine_get_sample_rate(&engine));
+    if(ma_decode_file(path, &cfg, &pcm_frames, &pcm) != MA_SUCCESS) { printf("GRESKA: Nije moguce ucitati zvuk: %s\n", path); return -1; }
+    for(voice_count=0; voice_count<AUDIO_VOICES; voice_count++) {
+        ma_audio_buffer_ref* src = &sources[voice_count];
+        if(ma_audio_buffer_ref_init(ma_format_f32, channels, pcm, pcm_frames, src) != MA_SUCCESS) break;
+        if(ma_sound_init_from_data_source(&engine, (ma_data_source*)src, MA_SOUND_FLAG_NO_SPATIALIZATION, NULL, &voices[voice_count]) != MA_SUCCESS) {
+            ma_audio_buffer_ref_uninit(src); break;
+        }
+        voice_started[voice_count] = 0;
+    }
+    return voice_count > 0 ? 0 : -1;
+}
+
+static void* init_main(void* arg) {
+    (void)arg;
+    engine_ok = ma_engine_init(NULL, &engine) == MA_SUCCESS;
+    if(!engine_ok) {
+        ma_backend backend = ma_backend_null;
+        if(ma_context_init(&backend, 1, NULL, &null_context) == MA_SUCCESS) {
+            ma_engine_config cfg = ma_engine_config_init(); cfg.pContext = &null_context;
+            engine_ok = ma_engine_init(&cfg, &engine) == MA_SUCCESS;
+            if(engine_ok) { null_backend = 1; printf("Zvuk: nema audio uredjaja, koristi se tihi (null) backend\n"); }
+            else ma_context_uninit(&null_context);
+        }
+    }
+    int ok = engine_ok && load_voices(sound_path) == 0;
+    if(!engine_ok) printf("Zvuk: audio engine nije pokrenut, nastavlja se bez zvuka\n");
+    pthread_mutex_lock(&init_lock); init_result = ok ? 1 : -1; pthread_mutex_unlock(&init_lock);
+    return NULL;
+}
+
+void audio_start_async(const char* path) {
+    if(init_pending || live) return;
+    snprintf(sound_path, sizeof(sound_path), "%s", path);
+    init_result = 0;
+    if(pthread_create(&init_thread, NULL, init_main, NULL) == 0) init_pending = 1;
+}
+
+void audio_begin_frame() {
+    started_this_frame = 0;
+    if(!init_pending) return;
+    pthread_mutex_lock(&init_lock); int r = init_result; pthread_mutex_unlock(&init_lock);
+    if(r == 0) return;
+    pthread_join(init_thread, NULL); init_pending = 0;
+    live = r > 0;
+}
+
+void audio_play() {
+    if(!live || started_this_frame >= AUDIO_MAX_PER_FRAME) return;
+    int v = -1;
+    for(int i=0; i<voice_count; i++) if(!ma_sound_is_playing(&voices[i])) { v = i; break; }
+    if(v < 0) {
+        v = 0;
+        for(int i=1; i<voice_count; i++) if(voice_started[i] < voice_started[v]) v = i;
+        ma_sound_stop(&voices[v]);
+    }
+    ma_sound_seek_to_pcm_frame(&voices[v], 0);
+    ma_sound_start(&voices[v]);
+    voice_started[v] = ++play_counter;
+    started_this_frame++;
+}
+
+void audio_shutdown() {
+    if(init_pending) { pthread_join(init_thread, NULL); init_pending = 0; }
+    live = 0;
+    for(int i=0; i<voice_count; i++) { ma_sound_uninit(&voices[i]); ma_audio_buffer_ref_uninit(&sources[i]); }
+    voice_count = 0;
+    if(pcm) { ma_free(pcm, NULL); pcm = NULL; }
+    if(engine_ok) { ma_engine_uninit(&engine); engine_ok = 0; }
+    if(null_backend) { ma_context_uninit(&null_context); null_backend = 0; }
+}
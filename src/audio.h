@@ -0,0 +1,22 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+// Move sound played through a fixed pool of preallocated voices sharing one
+// decoded PCM buffer. Nothing is loaded or allocated when a sound is played;
+// when all voices are busy the oldest one is restarted, and at most
+// AUDIO_MAX_PER_FRAME sounds start between two audio_begin_frame() calls.
+//
+// The engine is brought up on a background thread by audio_start_async(),
+// so device enumeration never delays the first frame. If no device can be
+// opened it falls back to miniaudio's silent null backend; until the thread
+// finishes (or if everything fails) audio_play() is a no-op.
+
+#define AUDIO_VOICES 8
+#define AUDIO_MAX_PER_FRAME 2
+
+void audio_start_async(const char* path);
+void audio_begin_frame();
+void audio_play();
+void audio_shutdown();
+
+#endif
@@ -0,0 +1,315 @@
+// bench: microbenchmarks for the CPU hot paths - move application, state hashing, solved
+// checks, history compaction, scramble generation, solver latency over a fixed corpus and
+// frame building through the null render backend (no GL context, see render.h). Every case
+// runs warmup batches, then timed repetitions of a fixed batch; results are per operation
+// (min, median, mean, standard deviation, max), printed as a table and optionally written as
+// JSON so two builds can be compared.
+//   bench [--reps N] [--warmup N] [--filter TEXT] [--json FILE] [--list]
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "cube.h"
+#include "wall.h"
+#include "hud.h"
+#include "scene.h"
+#include "render.h"
+
+typedef struct {
+    const char* name;
+    int n, arg;              // cube size (or wall cubes) and a case-specific count
+    int (*setup)(int n, int arg);
+    void (*prepare)(void);   // before every batch, untimed; may be NULL
+    void (*run)(void);       // one batch of ops operations
+    void (*teardown)(void);
+    int ops;
+} BenchCase;
+
+typedef struct { double min, median, mean, stddev, max; } BenchStats;
+
+#ifdef __VERSION__
+#define BENCH_COMPILER __VERSION__
+#else
+#define BENCH_COMPILER "unknown"
+#endif
+
+static double now() { struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+
+static Cube cube;
+static MoveCode* moves; static int move_count;
+static MoveLog log_buf;
+static unsigned char stickers[6*CUBE_MAX_N*CUBE_MAX_N];
+static volatile unsigned long long sink;
+static int bench_n, bench_arg, corpus_seed;
+
+// --- state helpers: the game itself only tracks history, so these live here ---
+
+// FNV-1a over the logical layout (position and orientation of every surface cubie).
+static unsigned long long state_hash(const Cube* c) {
+    unsigned long long h = 14695981039346656037ull;
+    const unsigned char* p = (const unsigned char*)c->layout.pos;
+    for(size_t i=0; i<3*(size_t)c->count; i++) { h ^= p[i]; h *= 1099511628211ull; }
+    for(int i=0; i<c->count; i++) { h ^= c->layout.orient[i]; h *= 1099511628211ull; }
+    return h;
+}
+
+// Every face one colour; stops at the first mismatch (solved_mixed), a solved cube is the
+// full scan (solved).
+static int is_solved(const Cube* c) {
+    int n = c->n;
+    cube_stickers(c, 1, stickers);
+    for(int f=0; f<6; f++) {
+        const unsigned char* s = stickers + (size_t)f*n*n;
+        for(int i=1; i<n*n; i++) if(s[i] != s[0]) return 0;
+    }
+    return 1;
+}
+
+static int fresh_cube(int n) {
+    cube_free(&cube);
+    if(cube_init(&cube, n) != 0) return -1;
+    cube.turbo_budget = 1e-6f;  // auto shuffle/solve commit everything in one step
+    return 0;
+}
+
+// Auto shuffle/solve until idle, without animation.
+static void run_auto(Cube* c) { while(c->shuffling || c->solving) cube_step(c); }
+
+static void scramble(int moves_n) { cube_shuffle(&cube, moves_n); run_auto(&cube); }
+
+// --- move application (logical layout only, same operation as --move-bench) ---
+
+// arg: 0 random layers, 1 outer layers only, 2 inner layers only.
+static int move_setup(int n, int kind) {
+    if(fresh_cube(n) != 0) return -1;
+    move_count = 4096; moves = malloc(sizeof(MoveCode)*move_count);
+    if(!moves) return -1;
+    srand(1);
+    for(int m=0; m<move_count; m++) {
+        int layer = kind==0 ? rand()%n : kind==1 ? (rand()%2)*(n-1) : (n>2 ? 1 + rand()%(n-2) : 0);
+        moves[m] = move_encode("xyz"[rand()%3], layer, (rand()%2)*2-1);
+    }
+    return 0;
+}
+
+static void move_run() {
+    for(int m=0; m<move_count; m++) { char ax; int l; float d; move_decode(moves[m], &ax, &l, &d); cube_rotate_logical(&cube, ax, l, (int)d); }
+}
+
+static void move_teardown() { free(moves); moves = NULL; cube_free(&cube); }
+
+// --- state hashing and solved checks ---
+
+static int state_setup(int n, int scrambled) {
+    if(fresh_cube(n) != 0) return -1;
+    srand(2);
+    if(scrambled) scramble(200);
+    return 0;
+}
+
+static void hash_run() { for(int i=0; i<64; i++) sink += state_hash(&cube); }
+static void solved_run() { for(int i=0; i<64; i++) sink += is_solved(&cube); }
+static void stickers_run() { for(int i=0; i<64; i++) { cube_stickers(&cube, 1, stickers); sink += stickers[i]; } }
+static void cube_teardown() { cube_free(&cube); }
+
+// --- history compaction ---
+
+// arg: moves per batch; random moves on n layers, so small cubes cancel and merge often.
+static int compact_setup(int n, int count) {
+    move_count = count; moves = malloc(sizeof(MoveCode)*count);
+    if(!moves) return -1;
+    srand(3);
+    for(int m=0; m<count; m++) moves[m] = move_encode("xyz"[rand()%3], rand()%n, (rand()%2)*2-1);
+    movelog_init(&log_buf);
+    return 0;
+}
+
+static void compact_prepare() { movelog_clear(&log_buf); }
+static void compact_run() { for(int m=0; m<move_count; m++) movelog_push_compact(&log_buf, moves[m]); sink += log_buf.count; }
+static void compact_teardown() { free(moves); moves = NULL; movelog_free(&log_buf); }
+
+// --- scramble generation and solver latency ---
+
+static int auto_setup(int n, int length) { bench_n = n; bench_arg = length; corpus_seed = 0; return fresh_cube(n); }
+
+static void scramble_prepare() { fresh_cube(bench_n); srand(100 + corpus_seed++); }
+static void scramble_run() { scramble(bench_arg); }
+
+// The corpus: scrambles from seeds 1000.. of the case's size and length, cycled over the
+// repetitions; the solve is checked once per batch.
+static void solve_prepare() { fresh_cube(bench_n); srand(1000 + corpus_seed++ % 16); scramble(bench_arg); }
+static void solve_run() { cube_solve(&cube); run_auto(&cube); }
+
+// --- frame building (null render backend) ---
+
+static SceneFrame frame; static unsigned int frame_version = ~0u; static int frame_count;
+
+static void build_hud() {
+    char buf[64];
+    hud_begin(1024, 768);
+    hud_rect(10, 10, 260, 170, HUD_RGBA(0,0,0,150));
+    snprintf(buf, sizeof(buf), "VREME   %02d:%05.2f", frame_count/3600, fmod(frame_count/60.0, 60.0)); hud_text(20, 20, 14, HUD_RGBA(255,255,255,255), buf);
+    snprintf(buf, sizeof(buf), "POTEZI  %d", (int)cube.history.count); hud_text(20, 42, 14, HUD_RGBA(255,255,255,255), buf);
+    hud_text(20, 86, 14, HUD_RGBA(255,210,80,255), "U TOKU");
+    for(int i=0; i<120; i++) hud_rect(20.0f + i*2.0f, 150.0f, 1.5f, 20.0f, HUD_RGBA(80,220,80,220));
+    hud_draw();
+}
+
+// arg: 1 keeps the cube turning (shuffle without turbo), so every frame animates and the
+// stickers are re-extracted whenever a turn lands.
+static int frame_setup(int n, int animate) {
+    rc_use(&rc_null);
+    scene_init(1024, 768);
+    if(fresh_cube(n) != 0) return -1;
+    srand(4);
+    cube.turbo_budget = 0;
+    if(animate) cube_shuffle(&cube, 1<<30);
+    frame.n = n; frame.stickers = stickers; frame_count = 0;
+    static float angles[CUBE_MAX_N]; frame.anim_angles = angles;
+    return 0;
+}
+
+// What a windowed frame does on the CPU: a simulation step, the snapshot (stickers only
+// when the view changed), camera and light, the scene passes and the HUD.
+static void frame_run() {
+    cube_step(&cube);
+    if(cube.view_version != frame_version) { cube_stickers(&cube, 0, stickers); frame_version = cube.view_version; }
+    frame.version = cube.view_version;
+    frame.anim_axis = cube.anim_moves ? cube.anim_axis-'x' : -1;
+    float* angles = (float*)frame.anim_angles;
+    for(int i=0; i<cube.n; i++) angles[i] = cube.anim_moves ? glm_rad(cube.anim_angle*cube.anim_turns[i]) : 0.0f;
+    scene_camera(&frame, 45.0f, -30.0f, 8.0f, frame_count++/60.0f);
+    scene_draw(&frame, 0, 1024, 768);
+    build_hud();
+}
+
+static void frame_teardown() { cube_free(&cube); scene_shutdown(); frame_version = ~0u; }
+
+static int wall_setup(int count, int unused) {
+    (void)unused;
+    rc_use(&rc_null);
+    scene_init(1024, 768);
+    srand(5);
+    if(wall_init(count) != 0) return -1;
+    scene_wall_resize(count);
+    frame_count = 0;
+    return 0;
+}
+
+static void wall_run() {
+    wall_step();
+    scene_camera(&frame, 0.0f, 0.0f, fmaxf(8.0f, wall_extent*1.4f), frame_count++/60.0f);
+    scene_draw(&frame, 0, 1024, 768);
+    build_hud();
+}
+
+static void wall_teardown() { wall_free(); scene_shutdown(); }
+
+static const BenchCase cases[] = {
+    { "move_random",   3, 0, move_setup, NULL, move_run, move_teardown, 4096 },
+    { "move_random",  20, 0, move_setup, NULL, move_run, move_teardown, 4096 },
+    { "move_random",  64, 0, move_setup, NULL, move_run, move_teardown, 4096 },
+    { "move_outer",   64, 1, move_setup, NULL, move_run, move_teardown, 4096 },
+    { "move_inner",   64, 2, move_setup, NULL, move_run, move_teardown, 4096 },
+    { "state_hash",    3, 1, state_setup, NULL, hash_run, cube_teardown, 64 },
+    { "state_hash",   64, 1, state_setup, NULL, hash_run, cube_teardown, 64 },
+    { "stickers",      3, 1, state_setup, NULL, stickers_run, cube_teardown, 64 },
+    { "stickers",     64, 1, state_setup, NULL, stickers_run, cube_teardown, 64 },
+    { "solved",        3, 0, state_setup, NULL, solved_run, cube_teardown, 64 },
+    { "solved",       64, 0, state_setup, NULL, solved_run, cube_teardown, 64 },
+    { "solved_mixed",  3, 1, state_setup, NULL, solved_run, cube_teardown, 64 },
+    { "solved_mixed", 64, 1, state_setup, NULL, solved_run, cube_teardown, 64 },
+    { "compact",       3, 4096, compact_setup, compact_prepare, compact_run, compact_teardown, 4096 },
+    { "compact",      64, 4096, compact_setup, compact_prepare, compact_run, compact_teardown, 4096 },
+    { "scramble",      3, 1000, auto_setup, scramble_prepare, scramble_run, cube_teardown, 1000 },
+    { "scramble",     64, 1000, auto_setup, scramble_prepare, scramble_run, cube_teardown, 1000 },
+    { "solve",         3, 20, auto_setup, solve_prepare, solve_run, cube_teardown, 1 },
+    { "solve",         3, 1000, auto_setup, solve_prepare, solve_run, cube_teardown, 1 },
+    { "solve",        20, 1000, auto_setup, solve_prepare, solve_run, cube_teardown, 1 },
+    { "solve",        64, 10000, auto_setup, solve_prepare, solve_run, cube_teardown, 1 },
+    { "frame_idle",    3, 0, frame_setup, NULL, frame_run, frame_teardown, 1 },
+    { "frame_turning", 3, 1, frame_setup, NULL, frame_run, frame_teardown, 1 },
+    { "frame_turning",64, 1, frame_setup, NULL, frame_run, frame_teardown, 1 },
+    { "frame_wall", 1024, 0, wall_setup, NULL, wall_run, wall_teardown, 1 },
+};
+#define CASE_COUNT (int)(sizeof(cases)/sizeof(cases[0]))
+
+static int cmp_double(const void* a, const void* b) { double x = *(const double*)a, y = *(const double*)b; return (x > y) - (x < y); }
+
+// Nanoseconds per operation over reps timed batches.
+static int run_case(const BenchCase* bc, int reps, int warmup, BenchStats* st) {
+    if(bc->setup(bc->n, bc->arg) != 0) { printf("GRESKA: %s n=%d nije pokrenut\n", bc->name, bc->n); bc->teardown(); return -1; }
+    double* t = malloc(sizeof(double)*reps);
+    if(!t) { bc->teardown(); return -1; }
+    for(int i=0; i<warmup; i++) { if(bc->prepare) bc->prepare(); bc->run(); }
+    for(int i=0; i<reps; i++) {
+        if(bc->prepare) bc->prepare();
+        double t0 = now();
+        bc->run();
+        t[i] = (now()-t0)*1e9/bc->ops;
+        if(bc->run == solve_run && !is_solved(&cube)) printf("GRESKA: %s n=%d: kocka nije resena\n", bc->name, bc->n);
+    }
+    qsort(t, reps, sizeof(double), cmp_double);
+    double sum = 0, sq = 0;
+    for(int i=0; i<reps; i++) sum += t[i];
+    st->mean = sum/reps;
+    for(int i=0; i<reps; i++) sq += (t[i]-st->mean)*(t[i]-st->mean);
+    st->stddev = reps > 1 ? sqrt(sq/(reps-1)) : 0.0;
+    st->min = t[0]; st->max = t[reps-1];
+    st->median = reps%2 ? t[reps/2] : (t[reps/2-1] + t[reps/2])*0.5;
+    free(t);
+    bc->teardown();
+    return 0;
+}
+
+static const char* fmt_ns(double ns, char* buf, size_t size) {
+    if(ns < 1e3) snprintf(buf, size, "%.1f ns", ns);
+    else if(ns < 1e6) snprintf(buf, size, "%.2f us", ns/1e3);
+    else snprintf(buf, size, "%.3f ms", ns/1e6);
+    return buf;
+}
+
+int main(int argc, char** argv) {
+    int reps = 15, warmup = 3, list = 0; const char* filter = NULL; const char* json_path = NULL;
+    for(int i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--reps") && i+1<argc) reps = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--warmup") && i+1<argc) warmup = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--filter") && i+1<argc) filter = argv[++i];
+        else if(!strcmp(argv[i], "--json") && i+1<argc) json_path = argv[++i];
+        else if(!strcmp(argv[i], "--list")) list = 1;
+        else { printf("Nepoznata opcija: %s\n", argv[i]); return 1; }
+    }
+    if(reps < 1) reps = 1;
+    if(warmup < 0) warmup = 0;
+    if(list) { for(int c=0; c<CASE_COUNT; c++) printf("%s/%d/%d\n", cases[c].name, cases[c].n, cases[c].arg); return 0; }
+
+    FILE* json = NULL;
+    if(json_path && !(json = fopen(json_path, "w"))) { printf("GRESKA: nije moguce otvoriti %s\n", json_path); return 1; }
+    if(json) fprintf(json, "{\n  \"compiler\": \"%s\",\n  \"reps\": %d,\n  \"warmup\": %d,\n  \"unit\": \"ns/op\",\n  \"results\": [", BENCH_COMPILER, reps, warmup);
+    printf("%-14s %5s %6s %6s %12s %12s %12s %7s %12s\n", "slucaj", "n", "arg", "op", "medijana", "min", "prosek", "sd", "max");
+    int first = 1, failed = 0;
+    for(int c=0; c<CASE_COUNT; c++) {
+        const BenchCase* bc = &cases[c];
+        char name[64]; snprintf(name, sizeof(name), "%s/%d/%d", bc->name, bc->n, bc->arg);
+        if(filter && !strstr(name, filter)) continue;
+        BenchStats st;
+        if(run_case(bc, reps, warmup, &st) != 0) { failed++; continue; }
+        char b[4][32];
+        printf("%-14s %5d %6d %6d %12s %12s %12s %6.1f%% %12s\n", bc->name, bc->n, bc->arg, bc->ops, fmt_ns(st.median, b[0], 32), fmt_ns(st.min, b[1], 32),
+               fmt_ns(st.mean, b[2], 32), st.mean > 0 ? st.stddev/st.mean*100.0 : 0.0, fmt_ns(st.max, b[3], 32));
+        fflush(stdout);
+        if(json) {
+            fprintf(json, "%s\n    {\"name\": \"%s\", \"n\": %d, \"arg\": %d, \"ops\": %d, \"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"max\": %.3f}",
+                    first ? "" : ",", bc->name, bc->n, bc->arg, bc->ops, st.min, st.median, st.mean, st.stddev, st.max);
+            first = 0;
+        }
+    }
+    if(json) { fprintf(json, "\n  ]\n}\n"); fclose(json); }
+    return failed ? 1 : 0;
+}
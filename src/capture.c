@@ -0,0 +1,214 @@
+#include "capture.h"
+#include "image_write.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <glad/glad.h>
+
+#define CAPTURE_SLOTS 3
+#define CAPTURE_QUEUE 8
+
+typedef struct { unsigned char* pixels; int index; } CaptureItem;
+
+static int cap_on = 0, cap_w, cap_h, cap_fps; static CaptureFormat cap_fmt;
+static char cap_path[1024]; static FILE* cap_file = NULL;
+static unsigned int pbo[CAPTURE_SLOTS]; static GLsync fence[CAPTURE_SLOTS]; static int pbo_frame[CAPTURE_SLOTS];
+static int ring_head = 0, ring_count = 0, frame_index = 0, frames_written = 0, frames_dropped = 0;
+static int y4m_next = 0, frames_repeated = 0;  // writer side: next frame number of the Y4M stream
+
+static pthread_t writer; static pthread_mutex_t q_lock = PTHREAD_MUTEX_INITIALIZER; static pthread_cond_t q_cond = PTHREAD_COND_INITIALIZER;
+static CaptureItem queue[CAPTURE_QUEUE]; static int q_head = 0, q_count = 0, q_quit = 0;
+static unsigned char* free_bufs[CAPTURE_QUEUE]; static int free_count = 0;
+static unsigned char *yuv = NULL;
+
+CaptureFormat capture_format_for(const char* path) {
+    size_t n = strlen(path);
+    if(n>4 && !strcmp(path+n-4, ".y4m")) return CAPTURE_Y4M;
+    if(n>4 && !strcmp(path+n-4, ".png")) return CAPTURE_PNG;
+    return CAPTURE_RAW;
+}
+
+int capture_active() { return cap_on; }
+
+// The PNG path is handed to snprintf as the format, so it must hold exactly one integer
+// conversion (flags and width allowed, e.g. %05d) and nothing else but %% escapes.
+static int png_pattern_ok(const char* path) {
+    int conversions = 0;
+    for(const char* p = path; *p; p++) {
+        if(*p != '%') continue;
+        if(*++p == '%') continue;
+        while(*p && strchr("-+ #0", *p)) p++;
+        while(*p >= '0' && *p <= '9') p++;
+        if(*p != 'd' && *p != 'i' && *p != 'u') return 0;
+        conversions++;
+    }
+    return conversions == 1;
+}
+
+static void emit_y4m() {
+    fputs("FRAME\n", cap_file);
+    fwrite(yuv, 1, (size_t)cap_w*cap_h + 2*(size_t)((cap_w+1)/2)*((cap_h+1)/2), cap_file);
+}
+
+static void convert_y4m(const unsigned char* rgba) {
+    int cw = (cap_w+1)/2, ch = (cap_h+1)/2;
+    unsigned char *Y = yuv, *U = yuv + cap_w*cap_h, *V = U + cw*ch;
+    for(int y=0; y<cap_h; y++) {
+        const unsigned char* row = rgba + (size_t)(cap_h-1-y)*cap_w*4;
+        for(int x=0; x<cap_w; x++) {
+            const unsigned char* p = row + x*4;
+            Y[y*cap_w+x] = (unsigned char)(0.299f*p[0] + 0.587f*p[1] + 0.114f*p[2]);
+        }
+    }
+    for(int cy=0; cy<ch; cy++) for(int cx=0; cx<cw; cx++) {
+        float r=0, g=0, b=0; int n=0;
+        for(int dy=0; dy<2; dy++) for(int dx=0; dx<2; dx++) {
+            int x = cx*2+dx, y = cy*2+dy; if(x>=cap_w || y>=cap_h) continue;
+            const unsigned char* p = rgba + ((size_t)(cap_h-1-y)*cap_w + x)*4;
+            r+=p[0]; g+=p[1]; b+=p[2]; n++;
+        }
+        r/=n; g/=n; b/=n;
+        U[cy*cw+cx] = (unsigned char)(128.0f - 0.168736f*r - 0.331264f*g + 0.5f*b);
+        V[cy*cw+cx] = (unsigned char)(128.0f + 0.5f*r - 0.418688f*g - 0.081312f*b);
+    }
+}
+
+// Y4M has a fixed frame rate, so a dropped frame is filled with the one before it (frames
+// dropped before the first are filled with the first) and the stream keeps wall-clock time.
+static void write_y4m(const CaptureItem* it) {
+    if(y4m_next > 0) for(; y4m_next < it->index; y4m_next++) { emit_y4m(); frames_repeated++; }
+    convert_y4m(it->pixels);
+    for(; y4m_next < it->index; y4m_next++) { emit_y4m(); frames_repeated++; }
+    emit_y4m(); y4m_next = it->index + 1;
+}
+
+static void write_item(CaptureItem* it) {
+    if(cap_fmt == CAPTURE_PNG) {
+        char path[1100]; snprintf(path, sizeof(path), cap_path, it->index);
+        write_png(path, cap_w, cap_h, 4, it->pixels, 1);
+    } else if(cap_fmt == CAPTURE_Y4M) write_y4m(it);
+    else for(int y=cap_h-1; y>=0; y--) fwrite(it->pixels + (size_t)y*cap_w*4, 1, (size_t)cap_w*4, cap_file);
+}
+
+static void* writer_main(void* arg) {
+    (void)arg;
+    for(;;) {
+        pthread_mutex_lock(&q_lock);
+        while(q_count==0 && !q_quit) pthread_cond_wait(&q_cond, &q_lock);
+        if(q_count==0) { pthread_mutex_unlock(&q_lock); break; }
+        CaptureItem it = queue[q_head]; q_head = (q_head+1)%CAPTURE_QUEUE; q_count--;
+        pthread_mutex_unlock(&q_lock);
+
+        write_item(&it);
+
+        pthread_mutex_lock(&q_lock);
+        free_bufs[free_count++] = it.pixels; frames_written++;
+        pthread_mutex_unlock(&q_lock);
+    }
+    return NULL;
+}
+
+// Undoes a capture_start() that failed part way: frees the frame buffers and the Y4M buffer
+// and closes and removes the output file it had just created.
+static int start_failed(const char* why) {
+    printf("GRESKA: snimanje %s nije pokrenuto: %s\n", cap_path, why);
+    for(int i=0; i<free_count; i++) free(free_bufs[i]);
+    free_count = 0;
+    free(yuv); yuv = NULL;
+    if(cap_file) { fclose(cap_file); cap_file = NULL; remove(cap_path); }
+    return -1;
+}
+
+int capture_start(const char* path, CaptureFormat fmt, int w, int h, int fps) {
+    if(cap_on) return -1;
+    if(fmt == CAPTURE_PNG && !png_pattern_ok(path)) { printf("GRESKA: %s mora sadrzati tacno jedan broj frejma (npr. shots/f_%%05d.png)\n", path); return -1; }
+    cap_fmt = fmt; cap_w = w; cap_h = h; cap_fps = fps>0 ? fps : 60;
+    snprintf(cap_path, sizeof(cap_path), "%s", path);
+    if(fmt != CAPTURE_PNG) {
+        cap_file = fopen(path, "wb");
+        if(!cap_file) { printf("GRESKA: Nije moguce otvoriti fajl: %s\n", path); return -1; }
+        if(fmt == CAPTURE_Y4M) {
+            fprintf(cap_file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", w, h, cap_fps);
+            yuv = malloc((size_t)w*h + 2*(size_t)((w+1)/2)*((h+1)/2));
+            if(!yuv) return start_failed("nema memorije za Y4M bafer");
+        }
+    }
+    size_t size = (size_t)w*h*4;
+    for(free_count = 0; free_count < CAPTURE_QUEUE; free_count++)
+        if(!(free_bufs[free_count] = malloc(size))) return start_failed("nema memorije za bafere frejmova");
+    glGenBuffers(CAPTURE_SLOTS, pbo);
+    for(int i=0; i<CAPTURE_SLOTS; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+        fence[i] = NULL;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    q_head = q_count = q_quit = 0;
+    ring_head = ring_count = frame_index = frames_written = frames_dropped = 0;
+    y4m_next = frames_repeated = 0;
+    if(pthread_create(&writer, NULL, writer_main, NULL) != 0) { glDeleteBuffers(CAPTURE_SLOTS, pbo); return start_failed("nit za upis nije pokrenuta"); }
+    cap_on = 1;
+    printf("Snimanje: %s (%dx%d)\n", path, w, h);
+    return 0;
+}
+
+static int collect_oldest(GLuint64 timeout) {
+    int slot = ring_head;
+    GLenum r = glClientWaitSync(fence[slot], GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if(r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) return 0;
+    glDeleteSync(fence[slot]); fence[slot] = NULL;
+    ring_head = (ring_head+1)%CAPTURE_SLOTS; ring_count--;
+
+    pthread_mutex_lock(&q_lock);
+    unsigned char* dst = free_count>0 ? free_bufs[--free_count] : NULL;
+    pthread_mutex_unlock(&q_lock);
+    if(!dst) { frames_dropped++; return 1; }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+    void* src = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (size_t)cap_w*cap_h*4, GL_MAP_READ_BIT);
+    if(src) { memcpy(dst, src, (size_t)cap_w*cap_h*4); glUnmapBuffer(GL_PIXEL_PACK_BUFFER); }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pthread_mutex_lock(&q_lock);
+    if(src) { queue[(q_head+q_count)%CAPTURE_QUEUE] = (CaptureItem){dst, pbo_frame[slot]}; q_count++; pthread_cond_signal(&q_cond); }
+    else { free_bufs[free_count++] = dst; frames_dropped++; }
+    pthread_mutex_unlock(&q_lock);
+    return 1;
+}
+
+void capture_frame(unsigned int read_fbo, int w, int h) {
+    if(!cap_on) return;
+    if(w != cap_w || h != cap_h) { printf("Snimanje: velicina se promenila (%dx%d -> %dx%d), snimanje prekinuto\n", cap_w, cap_h, w, h); capture_stop(); return; }
+    while(ring_count>0 && collect_oldest(0)) {}
+    if(ring_count == CAPTURE_SLOTS) { frames_dropped++; frame_index++; return; }
+
+    int slot = (ring_head+ring_count)%CAPTURE_SLOTS;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+    glReadPixels(0, 0, cap_w, cap_h, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fence[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    pbo_frame[slot] = frame_index++;
+    ring_count++;
+}
+
+void capture_stop() {
+    if(!cap_on) return;
+    while(ring_count>0 && collect_oldest(1000000000ull)) {}
+    for(int i=0; i<CAPTURE_SLOTS; i++) if(fence[i]) { glDeleteSync(fence[i]); fence[i] = NULL; }
+    pthread_mutex_lock(&q_lock); q_quit = 1; pthread_cond_signal(&q_cond); pthread_mutex_unlock(&q_lock);
+    pthread_join(writer, NULL);
+    if(cap_fmt == CAPTURE_Y4M && y4m_next > 0) for(; y4m_next < frame_index; y4m_next++) { emit_y4m(); frames_repeated++; }
+    glDeleteBuffers(CAPTURE_SLOTS, pbo);
+    for(int i=0; i<free_count; i++) free(free_bufs[i]);
+    free_count = 0;
+    if(cap_file) { fclose(cap_file); cap_file = NULL; }
+    free(yuv); yuv = NULL;
+    cap_on = 0;
+    printf("Snimanje zavrseno: %d frejmova upisano, %d preskoceno", frames_written, frames_dropped);
+    if(cap_fmt == CAPTURE_Y4M && frames_repeated) printf(" (u Y4M popunjeno ponavljanjem: %d)", frames_repeated);
+    printf("\n");
+}
@@ -0,0 +1,22 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+// Asynchronous frame capture: glReadPixels into a ring of pixel-pack buffers,
+// mapped a few frames later once their fence has signaled, then written out
+// by a background thread. capture_frame() never waits on the GPU or on disk;
+// if either falls behind the frame is dropped and counted (a Y4M stream repeats
+// the previous frame in its place so playback keeps time).
+
+typedef enum { CAPTURE_RAW, CAPTURE_PNG, CAPTURE_Y4M } CaptureFormat;
+
+// .y4m -> Y4M stream, .png -> PNG sequence (path is a printf pattern with exactly one integer
+// conversion, e.g. shots/f_%05d.png; capture_start rejects anything else),
+// anything else -> raw top-down RGBA frames back to back.
+CaptureFormat capture_format_for(const char* path);
+int capture_start(const char* path, CaptureFormat fmt, int w, int h, int fps);
+// w x h is read_fbo's current size; capture stops if it no longer matches the start size.
+void capture_frame(unsigned int read_fbo, int w, int h);
+void capture_stop();
+int capture_active();
+
+#endif
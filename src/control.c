@@ -0,0 +1,159 @@
+#include "control.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define IN_CAP (4 + 2*CONTROL_MAX_BATCH)
+// Largest reply for an n-layer cube (CONTROL_STATE); a client's output buffer holds two.
+#define REPLY_MAX(n) (12 + 6*(size_t)(n)*(n))
+
+typedef struct { int fd; size_t in_len, out_pos, out_len, out_cap; unsigned char in[IN_CAP], *out; } ControlClient;
+
+static int listen_fd = -1; static char sock_path[108];
+static ControlClient clients[CONTROL_CLIENTS];
+static unsigned int moves_applied = 0;
+
+static void put16(unsigned char* p, unsigned int v) { p[0] = (unsigned char)v; p[1] = (unsigned char)(v >> 8); }
+static void put32(unsigned char* p, unsigned int v) { put16(p, v & 0xFFFF); put16(p+2, v >> 16); }
+
+// Removes a stale socket left at path; anything else there is not ours to delete (-1).
+static int remove_socket(const char* path) {
+    struct stat st;
+    if(lstat(path, &st) != 0) return errno == ENOENT ? 0 : -1;
+    if(!S_ISSOCK(st.st_mode)) { errno = EEXIST; return -1; }
+    return unlink(path);
+}
+
+int control_open(const char* path) {
+    struct sockaddr_un addr; memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(addr.sun_path)) { printf("GRESKA: putanja soketa je preduga: %s\n", path); return -1; }
+    strcpy(addr.sun_path, path); strcpy(sock_path, path);
+    for(int i=0; i<CONTROL_CLIENTS; i++) clients[i].fd = -1;
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listen_fd < 0) { printf("GRESKA: soket: %s\n", strerror(errno)); return -1; }
+    if(remove_socket(path) != 0) {
+        printf("GRESKA: soket %s: %s\n", path, errno == EEXIST ? "fajl postoji i nije soket" : strerror(errno)); close(listen_fd); listen_fd = -1; return -1;
+    }
+    // Owner-only: whoever can connect can turn the cube.
+    mode_t mask = umask(077);
+    int bound = bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr));
+    umask(mask);
+    if(bound != 0 || listen(listen_fd, CONTROL_CLIENTS) != 0) {
+        printf("GRESKA: soket %s: %s\n", path, strerror(errno)); close(listen_fd); listen_fd = -1; return -1;
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    printf("Kontrolni soket: %s\n", path);
+    return 0;
+}
+
+static void drop_client(ControlClient* cl) { close(cl->fd); cl->fd = -1; free(cl->out); cl->out = NULL; cl->out_cap = 0; }
+
+// Sizes the output buffer for replies about an n-layer cube; pending bytes are kept.
+static int reserve_out(ControlClient* cl, int n) {
+    size_t cap = 2*REPLY_MAX(n);
+    if(cl->out_cap >= cap) return 0;
+    unsigned char* p = realloc(cl->out, cap);
+    if(!p) return -1;
+    cl->out = p; cl->out_cap = cap;
+    return 0;
+}
+
+static void flush_client(ControlClient* cl) {
+    while(cl->out_pos < cl->out_len) {
+        ssize_t w = send(cl->fd, cl->out + cl->out_pos, cl->out_len - cl->out_pos, MSG_NOSIGNAL);
+        if(w > 0) { cl->out_pos += (size_t)w; continue; }
+        if(w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+        drop_client(cl); return;
+    }
+    if(cl->out_pos == cl->out_len) cl->out_pos = cl->out_len = 0;
+    else if(cl->out_pos > cl->out_cap/2) { memmove(cl->out, cl->out + cl->out_pos, cl->out_len - cl->out_pos); cl->out_len -= cl->out_pos; cl->out_pos = 0; }
+}
+
+// Handles complete messages from the input buffer until it runs out, the move budget is
+// spent or there is no room for another reply. Returns -1 on a protocol error.
+static int serve_client(ControlClient* cl, const Cube* c, int* budget, int (*apply)(MoveCode m)) {
+    size_t pos = 0;
+    while(cl->in_len - pos >= 4 && cl->out_cap - cl->out_len >= REPLY_MAX(c->n)) {
+        const unsigned char* h = cl->in + pos; unsigned char* r = cl->out + cl->out_len;
+        unsigned int count = h[2] | h[3]<<8;
+        if(h[0] == CONTROL_MOVES) {
+            if(count > CONTROL_MAX_BATCH) return -1;
+            if(cl->in_len - pos < 4 + 2*(size_t)count || (int)count > *budget) break;
+            unsigned int ok = 0;
+            for(unsigned int i=0; i<count; i++) {
+                MoveCode m = (MoveCode)(h[4+2*i] | h[5+2*i]<<8);
+                if((m & 3) != 3 && move_layer(m) < c->n && !c->shuffling && !c->solving && apply(m)) ok++;
+            }
+            *budget -= (int)count; moves_applied += ok;
+            r[0] = CONTROL_ACK; r[1] = 0; put16(r+2, ok); put32(r+4, moves_applied); cl->out_len += 8;
+            pos += 4 + 2*(size_t)count;
+        }
+        else if(h[0] == CONTROL_QUERY) {
+            unsigned int flags = (c->animating ? CONTROL_BUSY_ANIMATING : 0) | (c->shuffling ? CONTROL_BUSY_SHUFFLING : 0) | (c->solving ? CONTROL_BUSY_SOLVING : 0);
+            r[0] = CONTROL_STATE; r[1] = 0; put16(r+2, (unsigned int)c->n); put32(r+4, flags); put32(r+8, (unsigned int)c->history.count);
+            cube_stickers(c, 1, r+12); cl->out_len += 12 + 6*(size_t)c->n*c->n;
+            pos += 4;
+        }
+        else if(h[0] == CONTROL_PING) {
+            r[0] = CONTROL_PONG; r[1] = 0; put16(r+2, count); cl->out_len += 4;
+            pos += 4;
+        }
+        else return -1;
+    }
+    memmove(cl->in, cl->in + pos, cl->in_len - pos); cl->in_len -= pos;
+    return 0;
+}
+
+void control_poll(const Cube* c, int budget, int (*apply)(MoveCode m)) {
+    if(listen_fd < 0) return;
+    int fd;
+    while((fd = accept(listen_fd, NULL, NULL)) >= 0) {
+        int slot = -1;
+        for(int i=0; i<CONTROL_CLIENTS && slot<0; i++) if(clients[i].fd < 0) slot = i;
+        if(slot < 0) { close(fd); continue; }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+        int one = 1; setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        clients[slot].fd = fd; clients[slot].in_len = clients[slot].out_pos = clients[slot].out_len = 0;
+        clients[slot].out = NULL; clients[slot].out_cap = 0;
+    }
+    for(int i=0; i<CONTROL_CLIENTS; i++) {
+        ControlClient* cl = &clients[i];
+        if(cl->fd < 0) continue;
+        if(reserve_out(cl, c->n) != 0) { printf("Kontrolni soket: nema memorije, klijent odbacen\n"); drop_client(cl); continue; }
+        flush_client(cl);
+        // Read only what fits; whatever is left stays in the kernel buffer and blocks the sender.
+        while(cl->fd >= 0 && budget > 0 && cl->out_cap - cl->out_len >= REPLY_MAX(c->n)) {
+            int closed = 0;
+            if(cl->in_len < IN_CAP) {
+                ssize_t got = recv(cl->fd, cl->in + cl->in_len, IN_CAP - cl->in_len, 0);
+                if(got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) closed = 1;
+                if(got > 0) cl->in_len += (size_t)got;
+            }
+            size_t before = cl->in_len;
+            if(serve_client(cl, c, &budget, apply) != 0) { printf("Kontrolni soket: neispravna poruka, klijent odbacen\n"); drop_client(cl); break; }
+            if(closed) { drop_client(cl); break; }
+            flush_client(cl);
+            if(cl->fd < 0 || cl->in_len == before) break;
+        }
+    }
+}
+
+void control_close() {
+    if(listen_fd < 0) return;
+    for(int i=0; i<CONTROL_CLIENTS; i++) if(clients[i].fd >= 0) drop_client(&clients[i]);
+    close(listen_fd); listen_fd = -1; remove_socket(sock_path);
+}
@@ -0,0 +1,32 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include "cube.h"
+
+// Local control socket: other processes (bots, smart-cube bridges, test harnesses) drive the
+// cube over a Unix domain socket. Every message starts with a 4-byte header
+// [type][0][count, u16 little-endian]; all integers are little-endian.
+//   CONTROL_MOVES  count <= CONTROL_MAX_BATCH MoveCodes (u16) follow. Answered with CONTROL_ACK:
+//                  count = moves applied (turns during auto shuffle/solve or on a layer the
+//                  cube does not have are skipped), then u32 moves applied since startup.
+//   CONTROL_QUERY  Answered with CONTROL_STATE: count = n, then u32 flags (CONTROL_BUSY_*),
+//                  u32 history length and the 6n^2 logical sticker colours (cube_stickers layout).
+//   CONTROL_PING   Echoed back as CONTROL_PONG with the same count.
+// A batch is applied as a whole within one simulation step. At most `budget` moves are taken
+// per poll and a client is not read while its replies are backed up, so a fast sender is
+// slowed down by the full socket buffer instead of losing moves.
+
+enum { CONTROL_MOVES = 1, CONTROL_QUERY = 2, CONTROL_PING = 3, CONTROL_ACK = 0x81, CONTROL_STATE = 0x82, CONTROL_PONG = 0x83 };
+enum { CONTROL_BUSY_ANIMATING = 1, CONTROL_BUSY_SHUFFLING = 2, CONTROL_BUSY_SOLVING = 4 };
+
+#define CONTROL_DEFAULT_PATH "/tmp/rubik.sock"
+#define CONTROL_MAX_BATCH 1024
+#define CONTROL_CLIENTS 8
+#define CONTROL_TICK_BUDGET 4096   // moves taken per simulation step
+
+int control_open(const char* path);
+// apply() performs one move and returns 1 if it was accepted.
+void control_poll(const Cube* c, int budget, int (*apply)(MoveCode m));
+void control_close();
+
+#endif
@@ -0,0 +1,323 @@
+#include "cube.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+const float cube_palette[CUBE_COLORS][3] = {{0,0.6f,0}, {0,0,0.8f}, {0.8f,0,0}, {1,0.5f,0}, {0.9f,0.9f,0.9f}, {0.9f,0.9f,0}, {0.1f,0.1f,0.1f}};
+
+// The 24 axis-aligned orientations as integer rotation matrices, orient_turn[o][axis][q] the
+// orientation after q more quarter turns about axis, and orient_mats the same for rendering.
+static signed char orient_rot[24][3][3];
+static unsigned char orient_turn[24][3][4];
+static mat4 orient_mats[24];
+static int orient_ready = 0;
+static unsigned int view_versions = 0;
+
+static void quarter_turn(signed char out[3][3], signed char in[3][3], int axis) {
+    int b = (axis+1)%3, c = (axis+2)%3;
+    memcpy(out, in, 9);
+    for(int k=0; k<3; k++) { out[b][k] = -in[c][k]; out[c][k] = in[b][k]; }
+}
+
+static int orient_find(signed char r[3][3], int count) {
+    for(int i=0; i<count; i++) if(!memcmp(orient_rot[i], r, 9)) return i;
+    return -1;
+}
+
+static void orient_init() {
+    int count = 1;
+    memset(orient_rot, 0, sizeof(orient_rot));
+    orient_rot[0][0][0] = orient_rot[0][1][1] = orient_rot[0][2][2] = 1;
+    for(int i=0; i<count; i++) for(int a=0; a<3; a++) {
+        signed char r[3][3]; quarter_turn(r, orient_rot[i], a);
+        if(orient_find(r, count) < 0) memcpy(orient_rot[count++], r, 9);
+    }
+    for(int i=0; i<24; i++) {
+        for(int a=0; a<3; a++) {
+            signed char r[3][3]; memcpy(r, orient_rot[i], 9);
+            for(int q=0; q<4; q++) { orient_turn[i][a][q] = (unsigned char)orient_find(r, 24); signed char t[3][3]; quarter_turn(t, r, a); memcpy(r, t, 9); }
+        }
+        glm_mat4_identity(orient_mats[i]);
+        for(int row=0; row<3; row++) for(int col=0; col<3; col++) orient_mats[i][col][row] = orient_rot[i][row][col];
+    }
+    orient_ready = 1;
+}
+
+static int layout_init(CubeLayout* lay, int n, int count) {
+    memset(lay, 0, sizeof(*lay));
+    lay->pos = malloc(sizeof(*lay->pos)*count); lay->orient = calloc(count, 1);
+    int ok = lay->pos && lay->orient;
+    for(int f=0; f<6; f++) ok = ok && (lay->grid[f] = malloc(sizeof(int)*n*n));
+    return ok ? 0 : -1;
+}
+
+static void layout_free(CubeLayout* lay) {
+    free(lay->pos); free(lay->orient);
+    for(int f=0; f<6; f++) free(lay->grid[f]);
+    memset(lay, 0, sizeof(*lay));
+}
+
+static int layout_copy(CubeLayout* dst, const CubeLayout* src, int n, int count) {
+    if(layout_init(dst, n, count) != 0) return -1;
+    memcpy(dst->pos, src->pos, sizeof(*src->pos)*count); memcpy(dst->orient, src->orient, count);
+    for(int f=0; f<6; f++) memcpy(dst->grid[f], src->grid[f], sizeof(int)*n*n);
+    return 0;
+}
+
+// Writes slot s into the grid of every face its position touches.
+static void layout_place(CubeLayout* lay, int n, int s) {
+    const unsigned char* p = lay->pos[s];
+    for(int a=0; a<3; a++) if(p[a]==0 || p[a]==n-1) lay->grid[a*2 + (p[a]!=0)][p[(a+1)%3]*n + p[(a+2)%3]] = s;
+}
+
+static int layout_at(const CubeLayout* lay, int n, const int p[3]) {
+    for(int a=0; a<3; a++) if(p[a]==0 || p[a]==n-1) return lay->grid[a*2 + (p[a]!=0)][p[(a+1)%3]*n + p[(a+2)%3]];
+    return -1;
+}
+
+int cube_init(Cube* c, int n) {
+    memset(c, 0, sizeof(*c));
+    if(n < 2) n = 2;
+    if(n > CUBE_MAX_N) n = CUBE_MAX_N;
+    c->n = n; c->count = 6*n*n - 12*n + 8;
+    movelog_init(&c->history); movelog_init(&c->redo);
+    c->last_move = 0; c->shuffle_next = MOVE_NONE;
+    c->anim_axis = 'y';
+    c->animation_speed = 9.0f;
+    c->turbo_budget = 5.0f;
+    if(!orient_ready) orient_init();
+    c->cubies = malloc(sizeof(Cubie)*c->count);
+    c->anim_turns = calloc(n, sizeof(float)); c->group_turns = calloc(n, sizeof(float));
+    c->moved = malloc(sizeof(int)*n*n);
+    c->step_cap = CUBE_STEP_MOVES; c->step_moves = malloc(sizeof(MoveCode)*c->step_cap);
+    if(!c->cubies || !c->anim_turns || !c->group_turns || !c->moved || !c->step_moves || layout_init(&c->layout, n, c->count) != 0) { cube_free(c); return -1; }
+    int s = 0;
+    for(int x=0; x<n; x++) for(int y=0; y<n; y++) for(int z=0; z<n; z++) {
+        if(x>0 && x<n-1 && y>0 && y<n-1 && z>0 && z<n-1) continue;
+        unsigned char* p = c->layout.pos[s];
+        p[0] = x; p[1] = y; p[2] = z;
+        layout_place(&c->layout, n, s);
+        unsigned char* f = c->cubies[s].faces;
+        for(int i=0; i<6; i++) f[i] = CUBE_BLACK;
+        if(z==0) f[0] = CUBE_GREEN;
+        if(z==n-1) f[1] = CUBE_BLUE;
+        if(x==0) f[2] = CUBE_RED;
+        if(x==n-1) f[3] = CUBE_ORANGE;
+        if(y==0) f[4] = CUBE_WHITE;
+        if(y==n-1) f[5] = CUBE_YELLOW;
+        s++;
+    }
+    if(layout_copy(&c->view_layout, &c->layout, n, c->count) != 0) { cube_free(c); return -1; }
+    c->view_version = ++view_versions;
+    return 0;
+}
+
+void cube_free(Cube* c) {
+    movelog_free(&c->history); movelog_free(&c->redo);
+    layout_free(&c->layout); layout_free(&c->view_layout);
+    free(c->cubies); free(c->anim_turns); free(c->group_turns); free(c->moved); free(c->step_moves);
+    c->cubies = NULL; c->anim_turns = c->group_turns = NULL; c->moved = NULL; c->step_moves = NULL; c->count = 0;
+}
+
+// Turns one layer by a number of quarter turns. Only the layer's surface cubies are read from
+// the face grids - all n*n of an outer layer, the 4(n-1) ring of an inner one - so the cost
+// follows the layer, not the cube. Positions rotate exactly, orientations go through the
+// composition table, and the moved cubies are written back into the grids.
+static void rotate_layer(CubeLayout* lay, int* moved, int n, char axis, int layer, int quarters) {
+    int a = axis-'x', b = (a+1)%3, c = (a+2)%3, q = quarters & 3, k = 0;
+    if(!q || layer < 0 || layer >= n) return;
+    int outer = layer==0 || layer==n-1;
+    for(int i=0; i<n; i++) for(int j=0; j<n; j += (outer || i==0 || i==n-1) ? 1 : n-1) {
+        int p[3]; p[a]=layer; p[b]=i; p[c]=j; moved[k++] = layout_at(lay, n, p);
+    }
+    for(int m=0; m<k; m++) {
+        int s = moved[m]; unsigned char* p = lay->pos[s];
+        for(int r=0; r<q; r++) { unsigned char t = p[b]; p[b] = n-1-p[c]; p[c] = t; }
+        lay->orient[s] = orient_turn[lay->orient[s]][a][q];
+    }
+    for(int m=0; m<k; m++) layout_place(lay, n, moved[m]);
+}
+
+void cube_rotate_logical(Cube* c, char axis, int layer, int quarters) { rotate_layer(&c->layout, c->moved, c->n, axis, layer, quarters); }
+
+void cube_rotate_layer_fixed(Cube* c, char axis, int layer, int quarters) {
+    rotate_layer(&c->layout, c->moved, c->n, axis, layer, quarters);
+    rotate_layer(&c->view_layout, c->moved, c->n, axis, layer, quarters);
+    c->view_version = ++view_versions;
+}
+
+// Adds a move to a group of simultaneous turns about one axis. Distinct layers turn together,
+// and a second identical quarter turn of a layer upgrades it to a half turn.
+static int group_join(char axis, float* turns, MoveCode m) {
+    Move mv; move_decode(m, &mv.axis, &mv.layer, &mv.dir);
+    if(mv.axis != axis) return 0;
+    float* t = &turns[mv.layer];
+    if(*t == 0) { *t = mv.dir; return 1; }
+    if(*t == mv.dir && fabsf(mv.dir) < 1.5f) { *t = 2*mv.dir; return 1; }
+    return 0;
+}
+
+static void start_animation(Cube* c) {
+    c->anim_angle = 0; c->anim_moves = 0;
+    if(c->queue_count == 0) return;
+    c->anim_axis = 'x' + (c->queue[c->queue_head] & 3);
+    while(c->anim_moves < c->queue_count && group_join(c->anim_axis, c->anim_turns, c->queue[(c->queue_head + c->anim_moves) % CUBE_QUEUE])) c->anim_moves++;
+}
+
+static void finish_animation(Cube* c) {
+    for(int i=0; i<c->anim_moves; i++) {
+        Move mv; move_decode(c->queue[(c->queue_head + i) % CUBE_QUEUE], &mv.axis, &mv.layer, &mv.dir);
+        rotate_layer(&c->view_layout, c->moved, c->n, mv.axis, mv.layer, (int)mv.dir);
+        c->anim_turns[mv.layer] = 0;
+    }
+    c->queue_head = (c->queue_head + c->anim_moves) % CUBE_QUEUE; c->queue_count -= c->anim_moves;
+    c->anim_moves = 0; c->animating = c->queue_count > 0;
+    c->view_version = ++view_versions;
+}
+
+int cube_trigger(Cube* c, char ax, int l, float d, int rec) {
+    MoveCode m = move_encode(ax, l, d);
+    // A full queue skips the oldest animation rather than dropping the new move.
+    if(c->queue_count == CUBE_QUEUE) { if(!c->anim_moves) start_animation(c); finish_animation(c); }
+    c->queue[(c->queue_head + c->queue_count++) % CUBE_QUEUE] = m;
+    rotate_layer(&c->layout, c->moved, c->n, ax, l, (int)d);
+    c->last_move = m; c->animating = 1;
+    if(rec) movelog_clear(&c->redo);
+    return rec && movelog_push_compact(&c->history, m) == 0;
+}
+
+static void step_move(Cube* c, MoveCode m, int rec) {
+    Move mv; move_decode(m, &mv.axis, &mv.layer, &mv.dir);
+    cube_trigger(c, mv.axis, mv.layer, mv.dir, rec);
+    if(c->step_count < CUBE_STEP_MOVES) c->step_moves[c->step_count++] = m;
+}
+
+// Both log the move on the other side before taking it off this one, so a failed push leaves
+// the logs and the cube as they were.
+int cube_undo(Cube* c) {
+    if(c->shuffling || c->solving || c->history.count==0) return 0;
+    MoveCode m = movelog_get(&c->history, c->history.count-1);
+    if(movelog_push(&c->redo, m) != 0) return 0;
+    movelog_pop(&c->history);
+    Move mv; move_decode(move_inverse(m), &mv.axis, &mv.layer, &mv.dir);
+    cube_trigger(c, mv.axis, mv.layer, mv.dir, 0);
+    return 1;
+}
+
+int cube_redo(Cube* c) {
+    if(c->shuffling || c->solving || c->redo.count==0) return 0;
+    MoveCode m = movelog_get(&c->redo, c->redo.count-1);
+    if(movelog_push_compact(&c->history, m) != 0) return 0;
+    movelog_pop(&c->redo);
+    Move mv; move_decode(m, &mv.axis, &mv.layer, &mv.dir);
+    cube_trigger(c, mv.axis, mv.layer, mv.dir, 0);
+    return 1;
+}
+
+// Animated auto moves run at speed 20, i.e. ceil(90/20) = 5 frames per slot. When that would
+// overrun turbo_budget seconds, moves are committed straight to the state at a fixed per-step rate.
+// They are reported through step_moves like animated ones; if that cannot grow, the rate drops to fit.
+static void turbo_plan(Cube* c, size_t moves) {
+    double seconds = moves * 5 / 60.0;
+    c->turbo_rate = c->turbo_budget > 0 && seconds > c->turbo_budget ? (int)fmin(ceil(moves / (c->turbo_budget*60.0)), (double)moves) : 0;
+    c->turbo_total = moves; c->turbo_done = 0;
+    if(c->turbo_rate > c->step_cap) {
+        MoveCode* p = realloc(c->step_moves, sizeof(MoveCode)*c->turbo_rate);
+        if(p) { c->step_moves = p; c->step_cap = c->turbo_rate; } else c->turbo_rate = c->step_cap;
+    }
+}
+
+static void commit_move(Cube* c, MoveCode m, int rec) {
+    Move mv; move_decode(m, &mv.axis, &mv.layer, &mv.dir);
+    cube_rotate_layer_fixed(c, mv.axis, mv.layer, (int)mv.dir);
+    if(rec) movelog_push_compact(&c->history, m);
+    if(c->step_count < c->step_cap) c->step_moves[c->step_count++] = m;
+    c->turbo_done++;
+}
+
+void cube_shuffle(Cube* c, int moves) { c->shuffling=1; c->shuffle_moves=moves; movelog_clear(&c->redo); turbo_plan(c, moves); }
+void cube_solve(Cube* c) { if(c->history.count>0 && !c->shuffling) { c->solving=1; movelog_clear(&c->redo); turbo_plan(c, c->history.count); } }
+
+static MoveCode shuffle_move(const Cube* c) { return move_encode("xyz"[rand()%3], rand()%c->n, (rand()%2)*2-1); }
+
+int cube_step(Cube* c) {
+    int ev = 0;
+    c->step_count = 0;
+    if(!c->animating) {
+        // Auto shuffle/solve feed one whole group per step so parallel layers turn together.
+        float* turns = c->group_turns;
+        if(c->turbo_rate && (c->shuffling ? c->shuffle_moves>0 : c->solving && c->history.count>0)) {
+            for(int i=0; i<c->turbo_rate && c->shuffling && c->shuffle_moves>0; i++, c->shuffle_moves--) {
+                commit_move(c, c->shuffle_next != MOVE_NONE ? c->shuffle_next : shuffle_move(c), 1); c->shuffle_next = MOVE_NONE;
+            }
+            for(int i=0; i<c->turbo_rate && c->solving && c->history.count>0; i++) commit_move(c, move_inverse(movelog_pop(&c->history)), 0);
+            ev |= CUBE_EV_TURBO | CUBE_EV_MOVE;
+        }
+        else if(c->shuffling) {
+            if(c->shuffle_moves>0) {
+                if(c->shuffle_next == MOVE_NONE) c->shuffle_next = shuffle_move(c);
+                char axis = 'x' + (c->shuffle_next & 3);
+                do {
+                    if(c->shuffle_next == MOVE_NONE) c->shuffle_next = shuffle_move(c);
+                    if(!group_join(axis, turns, c->shuffle_next)) break;
+                    step_move(c, c->shuffle_next, 1); c->shuffle_next = MOVE_NONE;
+                } while(--c->shuffle_moves > 0 && c->step_count < CUBE_STEP_MOVES);
+                c->animation_speed=20; ev |= CUBE_EV_MOVE;
+            }
+            else { c->shuffling=0; c->animation_speed=9; c->turbo_rate=0; ev |= CUBE_EV_SHUFFLED; }
+        }
+        else if(c->solving && c->history.count>0) {
+            char axis = 'x' + (movelog_get(&c->history, c->history.count-1) & 3);
+            while(c->history.count>0 && c->step_count < CUBE_STEP_MOVES) {
+                MoveCode m = move_inverse(movelog_get(&c->history, c->history.count-1));
+                if(!group_join(axis, turns, m)) break;
+                movelog_pop(&c->history); step_move(c, m, 0);
+            }
+            c->animation_speed=20; ev |= CUBE_EV_MOVE;
+        }
+        else { c->solving=0; c->turbo_rate=0; ev |= CUBE_EV_IDLE; }
+        for(int i=0; i<c->step_count; i++) turns[move_layer(c->step_moves[i])] = 0;
+    }
+    if(c->animating && !c->anim_moves) start_animation(c);
+    // Moves queued behind the current group shorten it so a burst of input drains in about one move's time.
+    if(c->animating) { c->anim_angle+=c->animation_speed*(1 + c->queue_count - c->anim_moves); if(c->anim_angle>=90) finish_animation(c); }
+    return ev;
+}
+
+void cube_model(const Cube* c, int s, mat4 out) {
+    // Centred on the origin and scaled so any size spans the same 3 units as the 3x3x3.
+    const unsigned char* p = c->view_layout.pos[s];
+    float half = (c->n-1)*0.5f, k = 3.0f/c->n;
+    glm_mat4_copy(orient_mats[c->view_layout.orient[s]], out);
+    out[3][0] = p[0]-half; out[3][1] = p[1]-half; out[3][2] = p[2]-half;
+    int axis = c->anim_axis - 'x';
+    if(c->anim_moves && c->anim_turns[p[axis]] != 0) {
+        mat4 ar; glm_mat4_identity(ar); vec3 ax={0};
+        ax[axis] = 1;
+        glm_rotate(ar, glm_rad(c->anim_angle*c->anim_turns[p[axis]]), ax);
+        mat4 t; glm_mat4_mul(ar, out, t); glm_mat4_copy(t, out);
+    }
+    glm_scale(out, (vec3){0.95f*k, 0.95f*k, 0.95f*k});
+    out[3][0] *= k; out[3][1] *= k; out[3][2] *= k;
+}
+
+void cube_orientations(float out[24][9]) {
+    if(!orient_ready) orient_init();
+    for(int o=0; o<24; o++) for(int row=0; row<3; row++) for(int col=0; col<3; col++) out[o][col*3 + row] = orient_rot[o][row][col];
+}
+
+static int facelet(const Cube* c, const CubeLayout* lay, int face, int u, int v) {
+    // The world normal d = +-e_a seen from the cubie is R^T d; its non-zero axis picks the sticker.
+    int a = face/2, s = lay->grid[face][u*c->n + v];
+    const signed char (*r)[3] = (const signed char (*)[3])orient_rot[lay->orient[s]];
+    for(int k=0; k<3; k++) if(r[a][k]) return c->cubies[s].faces[((k+1)%3)*2 + ((r[a][k] > 0) == (face & 1))];
+    return CUBE_BLACK;
+}
+
+int cube_facelet(const Cube* c, int face, int u, int v) { return facelet(c, &c->view_layout, face, u, v); }
+
+void cube_stickers(const Cube* c, int logical, unsigned char* out) {
+    const CubeLayout* lay = logical ? &c->layout : &c->view_layout; int n = c->n;
+    for(int f=0; f<6; f++) for(int u=0; u<n; u++) for(int v=0; v<n; v++) out[(f*n + u)*n + v] = (unsigned char)facelet(c, lay, f, u, v);
+}
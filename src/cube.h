@@ -0,0 +1,77 @@
+#ifndef CUBE_H
+#define CUBE_H
+
+#include <cglm/cglm.h>
+
+#include "movelog.h"
+
+typedef struct { char axis; int layer; float dir; } Move;
+typedef struct { unsigned char faces[6]; } Cubie;
+
+enum { CUBE_GREEN, CUBE_BLUE, CUBE_RED, CUBE_ORANGE, CUBE_WHITE, CUBE_YELLOW, CUBE_BLACK, CUBE_COLORS };
+extern const float cube_palette[CUBE_COLORS][3];
+
+// cube_step() events; turbo steps report CUBE_EV_MOVE too
+enum { CUBE_EV_MOVE = 1, CUBE_EV_SHUFFLED = 2, CUBE_EV_IDLE = 4, CUBE_EV_TURBO = 8 };
+
+// Exact state of the surface cubies (6n^2 - 12n + 8 of them; the hidden core is never stored).
+// pos[slot] is a cubie's grid position (0..n-1 per axis) and orient[slot] one of the 24
+// axis-aligned orientations. grid[axis*2 + side][u*n + v] is the layer membership index: the
+// slot showing on that face at the other two coordinates; edge and corner cubies are listed on
+// every face they touch.
+typedef struct { unsigned char (*pos)[3]; unsigned char* orient; int* grid[6]; } CubeLayout;
+
+#define CUBE_MAX_N 128
+#define CUBE_QUEUE 16
+#define CUBE_STEP_MOVES 6
+
+// layout is the logical state and changes as soon as a move is triggered; view_layout
+// trails it by the moves still waiting in the animation queue. Layers are indexed 0..n-1.
+typedef struct {
+    int n, count;
+    Cubie* cubies;
+    CubeLayout layout, view_layout;
+    MoveLog history, redo;
+    MoveCode queue[CUBE_QUEUE]; int queue_head, queue_count;
+    int animating, solving, shuffling, shuffle_moves;
+    // The animation in flight turns anim_moves queued moves at once: every layer of anim_axis
+    // with a non-zero entry in anim_turns (quarter turns, +-1 or +-2) rotates together.
+    float anim_angle, *anim_turns, *group_turns; char anim_axis; int anim_moves;
+    float animation_speed; MoveCode last_move, shuffle_next;
+    // Auto shuffle/solve longer than turbo_budget seconds of animation skip it and commit
+    // turbo_rate moves per step instead (CUBE_EV_TURBO); turbo_done/turbo_total is the progress.
+    float turbo_budget; int turbo_rate; size_t turbo_total, turbo_done;
+    // Moves issued by the last cube_step() call (auto shuffle/solve, turbo commits included),
+    // for logging; step_cap grows to turbo_rate when a turbo sequence is planned.
+    MoveCode* step_moves; int step_count, step_cap;
+    int* moved;
+    // Bumped whenever view_layout changes; unique across cubes, so a cached copy of the
+    // visible stickers knows when to refresh.
+    unsigned int view_version;
+} Cube;
+
+// n x n x n cube (clamped to 2..CUBE_MAX_N); -1 when out of memory.
+int cube_init(Cube* c, int n);
+void cube_free(Cube* c);
+// Turns a layer in both layouts at once (no animation).
+void cube_rotate_layer_fixed(Cube* c, char axis, int layer, int quarters);
+// Turns a layer in the logical layout only, i.e. the cost of applying one move; view_layout is
+// left behind, so this is for measurements, not for a cube that is drawn.
+void cube_rotate_logical(Cube* c, char axis, int layer, int quarters);
+int cube_trigger(Cube* c, char ax, int l, float d, int rec);
+// Step back/forward through the compacted history; 0 when there is nothing to do or the cube is busy.
+int cube_undo(Cube* c);
+int cube_redo(Cube* c);
+void cube_shuffle(Cube* c, int moves);
+void cube_solve(Cube* c);
+int cube_step(Cube* c);
+void cube_model(const Cube* c, int slot, mat4 out);
+// The 24 orientations as column-major 3x3 matrices, indexed like CubeLayout.orient.
+void cube_orientations(float out[24][9]);
+// Colour of the sticker showing at (u, v) of face axis*2 + side in view_layout, using the
+// same face/coordinate convention as CubeLayout.grid.
+int cube_facelet(const Cube* c, int face, int u, int v);
+// All 6n^2 facelets of the view layout (or the logical one), row face*n + u, column v.
+void cube_stickers(const Cube* c, int logical, unsigned char* out);
+
+#endif
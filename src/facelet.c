@@ -0,0 +1,80 @@
+#include "facelet.h"
+
+#include <glad/glad.h>
+
+#include "render.h"
+
+// Sticker inset inside a grid cell and body inset below the surface, in grid units.
+#define STICKER_GAP 0.03f
+#define BODY_INSET 0.02f
+
+static unsigned int face_prog, body_prog, body_vao, face_vao, sticker_tex, angle_tex;
+static int face_loc, n_loc, scale_loc, axis_loc, model_loc;
+static int tex_n = 0, angle_n = 0; static unsigned int tex_version = 0;
+
+int facelet_init(unsigned int program, unsigned int box_program, unsigned int box_vao) {
+    face_prog = program; body_prog = box_program; body_vao = box_vao;
+    glGenVertexArrays(1, &face_vao);
+    glGenTextures(1, &sticker_tex); glGenTextures(1, &angle_tex);
+    unsigned int texs[2] = { sticker_tex, angle_tex };
+    for(int i=0; i<2; i++) {
+        glBindTexture(GL_TEXTURE_2D, texs[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "texture1"), 0);
+    glUniform1i(glGetUniformLocation(program, "normalMap"), 1);
+    glUniform1i(glGetUniformLocation(program, "skybox"), 2);
+    glUniform1i(glGetUniformLocation(program, "stickers"), 3);
+    glUniform1i(glGetUniformLocation(program, "layerAngles"), 5);
+    glUniform1f(glGetUniformLocation(program, "gap"), STICKER_GAP);
+    glUniform3fv(glGetUniformLocation(program, "palette"), CUBE_COLORS, (const float*)cube_palette);
+    face_loc = glGetUniformLocation(program, "face"); n_loc = glGetUniformLocation(program, "n");
+    scale_loc = glGetUniformLocation(program, "scale"); axis_loc = glGetUniformLocation(program, "animAxis");
+    model_loc = glGetUniformLocation(box_program, "model");
+    return 0;
+}
+
+static void upload(int n, unsigned int version, const unsigned char* stickers) {
+    if(tex_n == n && tex_version == version) return;
+    rc_image(sticker_tex, RC_R8UI, n, 6*n, stickers, tex_n != n);
+    tex_n = n; tex_version = version;
+}
+
+// Body box covering layers l0..l1 of axis, turned by angle (radians) about it.
+static void draw_body(int n, int axis, int l0, int l1, float angle) {
+    float k = 3.0f/n, lo[3], hi[3];
+    for(int i=0; i<3; i++) { lo[i] = BODY_INSET; hi[i] = n - BODY_INSET; }
+    if(l0 > 0) lo[axis] = (float)l0;
+    if(l1 < n-1) hi[axis] = (float)(l1+1);
+    mat4 model; glm_mat4_identity(model); vec3 ax = {0};
+    ax[axis] = 1;
+    glm_scale(model, (vec3){k, k, k});
+    if(angle != 0) glm_rotate(model, angle, ax);
+    glm_translate(model, (vec3){(lo[0]+hi[0]-n)*0.5f, (lo[1]+hi[1]-n)*0.5f, (lo[2]+hi[2]-n)*0.5f});
+    glm_scale(model, (vec3){hi[0]-lo[0], hi[1]-lo[1], hi[2]-lo[2]});
+    rc_uniform(model_loc, RC_MAT4, 1, model);
+    rc_draw(0, 36, 0);
+}
+
+void facelet_draw(int n, unsigned int version, const unsigned char* stickers, int axis, const float* angles) {
+    upload(n, version, stickers);
+
+    rc_program(body_prog); rc_vertex_array(body_vao);
+    rc_attrib(3, cube_palette[CUBE_BLACK]);
+    if(axis < 0) draw_body(n, 0, 0, n-1, 0);
+    else for(int l0=0, l1; l0<n; l0=l1+1) {
+        for(l1=l0; l1+1<n && angles[l1+1]==angles[l0]; l1++);
+        draw_body(n, axis, l0, l1, angles[l0]);
+    }
+
+    rc_program(face_prog); rc_vertex_array(face_vao);
+    rc_texture(3, RC_TEX_2D, sticker_tex);
+    rc_uniform1i(n_loc, n); rc_uniform1f(scale_loc, 3.0f/n); rc_uniform1i(axis_loc, axis);
+    if(axis >= 0) {
+        rc_image(angle_tex, RC_R32F, n, 1, angles, angle_n != n); angle_n = n;
+        rc_texture(5, RC_TEX_2D, angle_tex);
+    }
+    for(int f=0; f<6; f++) { rc_uniform1i(face_loc, f); rc_draw(0, 6, n*n); }
+}
@@ -0,0 +1,21 @@
+#ifndef FACELET_H
+#define FACELET_H
+
+#include "cube.h"
+
+// Surface-only renderer for the single cube. The 6n^2 sticker colours live in an n x 6n
+// integer texture that is refreshed only when the view layout changes, and each face is one
+// instanced draw of an n x n grid of quads; the turning layers are rotated in the vertex
+// shader by the angles in a 1 x n float texture, updated on frames with a turn in flight. The black body underneath is a handful of boxes: one per
+// run of layers sharing an angle. Memory is O(n^2) and a frame costs 6 + (a few) draws
+// whatever the size.
+
+// program: facelet.vert + cube.frag; box_program/box_vao draw the body (cube.vert, 36 vertices).
+int facelet_init(unsigned int program, unsigned int box_program, unsigned int box_vao);
+// Expects view/projection/lightPos/viewPos already set on both programs and the cube
+// textures bound to units 0-2; uses units 3 (stickers) and 5 (layer angles). stickers is the cube_stickers() layout and is re-uploaded only
+// when version changes; axis is the turning axis (-1 when idle), angles one angle per layer in
+// radians. Issued as render commands (render.h).
+void facelet_draw(int n, unsigned int version, const unsigned char* stickers, int axis, const float* angles);
+
+#endif
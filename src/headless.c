@@ -0,0 +1,45 @@
+#include "headless.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static EGLDisplay egl_display = EGL_NO_DISPLAY;
+static EGLContext egl_context = EGL_NO_CONTEXT;
+
+int headless_init() {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay) egl_display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if(egl_display == EGL_NO_DISPLAY) egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if(egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, &major, &minor)) { printf("EGL: inicijalizacija nije uspela (0x%x)\n", eglGetError()); return -1; }
+    if(!eglBindAPI(EGL_OPENGL_API)) { printf("EGL: OpenGL API nije podrzan\n"); return -1; }
+
+    EGLint cfgAttr[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig cfg = NULL; EGLint n = 0;
+    eglChooseConfig(egl_display, cfgAttr, &cfg, 1, &n);
+    EGLint ctxAttr[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                         EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+    egl_context = eglCreateContext(egl_display, n>0 ? cfg : (EGLConfig)0, EGL_NO_CONTEXT, ctxAttr);
+    if(egl_context == EGL_NO_CONTEXT) { printf("EGL: kontekst 3.3 core nije kreiran (0x%x)\n", eglGetError()); return -1; }
+    if(!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)) { printf("EGL: surfaceless kontekst nije podrzan (0x%x)\n", eglGetError()); return -1; }
+    printf("EGL %d.%d headless kontekst spreman\n", major, minor);
+    return 0;
+}
+
+void* headless_proc(const char* name) { return (void*)eglGetProcAddress(name); }
+
+double headless_time() {
+    struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+void headless_shutdown() {
+    if(egl_display == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(egl_context != EGL_NO_CONTEXT) eglDestroyContext(egl_display, egl_context);
+    eglTerminate(egl_display);
+    egl_display = EGL_NO_DISPLAY; egl_context = EGL_NO_CONTEXT;
+}
@@ -0,0 +1,11 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Surfaceless EGL context (Mesa llvmpipe works without a display or GPU).
+// All rendering goes to FBOs; there is no default framebuffer.
+int headless_init();
+void* headless_proc(const char* name);
+double headless_time();
+void headless_shutdown();
+
+#endif
@@ -0,0 +1,157 @@
+#include "hud.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <glad/glad.h>
+
+#include "render.h"
+
+#define HUD_MAX_QUADS 4096
+#define CELL_W 32
+#define CELL_H 40
+#define FONT_SCALE 4
+#define FONT_PAD 6
+#define SDF_SPREAD 4.0f
+#define ATLAS_COLS 16
+#define ATLAS_W (CELL_W*ATLAS_COLS)
+#define ATLAS_H (CELL_H*6)
+#define SOLID_GLYPH 127
+
+typedef struct { float x, y, u, v; unsigned int rgba; } HudVertex;
+
+// 5x7 glyphs, one byte per row, bit 4 = leftmost column. Lowercase maps to uppercase.
+static const unsigned char font5x7[96][7] = {
+    ['!'-32] = {0x04,0x04,0x04,0x04,0x04,0x00,0x04}, ['%'-32] = {0x18,0x19,0x02,0x04,0x08,0x13,0x03},
+    ['\''-32] = {0x04,0x04,0x08,0x00,0x00,0x00,0x00}, ['('-32] = {0x02,0x04,0x08,0x08,0x08,0x04,0x02},
+    [')'-32] = {0x08,0x04,0x02,0x02,0x02,0x04,0x08}, ['+'-32] = {0x00,0x04,0x04,0x1F,0x04,0x04,0x00},
+    [','-32] = {0x00,0x00,0x00,0x00,0x0C,0x04,0x08}, ['-'-32] = {0x00,0x00,0x00,0x1F,0x00,0x00,0x00},
+    ['.'-32] = {0x00,0x00,0x00,0x00,0x00,0x0C,0x0C}, ['/'-32] = {0x00,0x01,0x02,0x04,0x08,0x10,0x00},
+    ['0'-32] = {0x0E,0x11,0x13,0x15,0x19,0x11,0x0E}, ['1'-32] = {0x04,0x0C,0x04,0x04,0x04,0x04,0x0E},
+    ['2'-32] = {0x0E,0x11,0x01,0x02,0x04,0x08,0x1F}, ['3'-32] = {0x1F,0x02,0x04,0x02,0x01,0x11,0x0E},
+    ['4'-32] = {0x02,0x06,0x0A,0x12,0x1F,0x02,0x02}, ['5'-32] = {0x1F,0x10,0x1E,0x01,0x01,0x11,0x0E},
+    ['6'-32] = {0x06,0x08,0x10,0x1E,0x11,0x11,0x0E}, ['7'-32] = {0x1F,0x01,0x02,0x04,0x08,0x08,0x08},
+    ['8'-32] = {0x0E,0x11,0x11,0x0E,0x11,0x11,0x0E}, ['9'-32] = {0x0E,0x11,0x11,0x0F,0x01,0x02,0x0C},
+    [':'-32] = {0x00,0x0C,0x0C,0x00,0x0C,0x0C,0x00}, ['<'-32] = {0x02,0x04,0x08,0x10,0x08,0x04,0x02},
+    ['='-32] = {0x00,0x00,0x1F,0x00,0x1F,0x00,0x00}, ['>'-32] = {0x08,0x04,0x02,0x01,0x02,0x04,0x08},
+    ['?'-32] = {0x0E,0x11,0x01,0x02,0x04,0x00,0x04},
+    ['A'-32] = {0x0E,0x11,0x11,0x11,0x1F,0x11,0x11}, ['B'-32] = {0x1E,0x11,0x11,0x1E,0x11,0x11,0x1E},
+    ['C'-32] = {0x0E,0x11,0x10,0x10,0x10,0x11,0x0E}, ['D'-32] = {0x1C,0x12,0x11,0x11,0x11,0x12,0x1C},
+    ['E'-32] = {0x1F,0x10,0x10,0x1E,0x10,0x10,0x1F}, ['F'-32] = {0x1F,0x10,0x10,0x1E,0x10,0x10,0x10},
+    ['G'-32] = {0x0E,0x11,0x10,0x17,0x11,0x11,0x0F}, ['H'-32] = {0x11,0x11,0x11,0x1F,0x11,0x11,0x11},
+    ['I'-32] = {0x0E,0x04,0x04,0x04,0x04,0x04,0x0E}, ['J'-32] = {0x07,0x02,0x02,0x02,0x02,0x12,0x0C},
+    ['K'-32] = {0x11,0x12,0x14,0x18,0x14,0x12,0x11}, ['L'-32] = {0x10,0x10,0x10,0x10,0x10,0x10,0x1F},
+    ['M'-32] = {0x11,0x1B,0x15,0x15,0x11,0x11,0x11}, ['N'-32] = {0x11,0x11,0x19,0x15,0x13,0x11,0x11},
+    ['O'-32] = {0x0E,0x11,0x11,0x11,0x11,0x11,0x0E}, ['P'-32] = {0x1E,0x11,0x11,0x1E,0x10,0x10,0x10},
+    ['Q'-32] = {0x0E,0x11,0x11,0x11,0x15,0x12,0x0D}, ['R'-32] = {0x1E,0x11,0x11,0x1E,0x14,0x12,0x11},
+    ['S'-32] = {0x0F,0x10,0x10,0x0E,0x01,0x01,0x1E}, ['T'-32] = {0x1F,0x04,0x04,0x04,0x04,0x04,0x04},
+    ['U'-32] = {0x11,0x11,0x11,0x11,0x11,0x11,0x0E}, ['V'-32] = {0x11,0x11,0x11,0x11,0x11,0x0A,0x04},
+    ['W'-32] = {0x11,0x11,0x11,0x15,0x15,0x15,0x0A}, ['X'-32] = {0x11,0x11,0x0A,0x04,0x0A,0x11,0x11},
+    ['Y'-32] = {0x11,0x11,0x11,0x0A,0x04,0x04,0x04}, ['Z'-32] = {0x1F,0x01,0x02,0x04,0x08,0x10,0x1F},
+    ['['-32] = {0x0E,0x08,0x08,0x08,0x08,0x08,0x0E}, [']'-32] = {0x0E,0x02,0x02,0x02,0x02,0x02,0x0E},
+    ['_'-32] = {0x00,0x00,0x00,0x00,0x00,0x00,0x1F}, ['|'-32] = {0x04,0x04,0x04,0x04,0x04,0x04,0x04},
+    [SOLID_GLYPH-32] = {0x1F,0x1F,0x1F,0x1F,0x1F,0x1F,0x1F},
+};
+
+static unsigned int hud_prog, hud_vao, hud_vbo, hud_atlas; static int size_loc;
+static int hud_w, hud_h, quad_count;
+static HudVertex verts[HUD_MAX_QUADS*6];
+
+static int font_bit(int glyph, int px, int py) {
+    int fx = (px - FONT_PAD)/FONT_SCALE, fy = (py - FONT_PAD)/FONT_SCALE;
+    if(px < FONT_PAD || py < FONT_PAD || fx >= 5 || fy >= 7) return 0;
+    return (font5x7[glyph][fy] >> (4-fx)) & 1;
+}
+
+static void build_atlas(unsigned char* atlas) {
+    int r = (int)SDF_SPREAD + 1;
+    for(int g=0; g<96; g++) {
+        int ox = (g%ATLAS_COLS)*CELL_W, oy = (g/ATLAS_COLS)*CELL_H;
+        for(int py=0; py<CELL_H; py++) for(int px=0; px<CELL_W; px++) {
+            int in = font_bit(g, px, py); float best = r*r*2.0f;
+            for(int dy=-r; dy<=r; dy++) for(int dx=-r; dx<=r; dx++) {
+                int qx = px+dx, qy = py+dy;
+                int qin = (qx>=0 && qy>=0 && qx<CELL_W && qy<CELL_H) ? font_bit(g, qx, qy) : 0;
+                if(qin != in) { float d = (float)(dx*dx+dy*dy); if(d < best) best = d; }
+            }
+            float dist = sqrtf(best) - 0.5f; if(!in) dist = -dist;
+            float v = 0.5f + dist/(2.0f*SDF_SPREAD);
+            atlas[(oy+py)*ATLAS_W + ox+px] = (unsigned char)(fminf(fmaxf(v, 0.0f), 1.0f)*255.0f);
+        }
+    }
+}
+
+int hud_init(unsigned int program) {
+    hud_prog = program;
+    unsigned char* atlas = malloc(ATLAS_W*ATLAS_H);
+    if(!atlas) return -1;
+    build_atlas(atlas);
+    glGenTextures(1, &hud_atlas); glBindTexture(GL_TEXTURE_2D, hud_atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_W, ATLAS_H, 0, GL_RED, GL_UNSIGNED_BYTE, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    free(atlas);
+
+    glGenVertexArrays(1, &hud_vao); glGenBuffers(1, &hud_vbo);
+    glBindVertexArray(hud_vao); glBindBuffer(GL_ARRAY_BUFFER, hud_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), NULL, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)0); glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)(2*sizeof(float))); glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (void*)(4*sizeof(float))); glEnableVertexAttribArray(2);
+
+    glUseProgram(hud_prog); glUniform1i(glGetUniformLocation(hud_prog, "atlas"), 0);
+    size_loc = glGetUniformLocation(hud_prog, "screenSize");
+    return 0;
+}
+
+void hud_begin(int fb_width, int fb_height) { hud_w = fb_width; hud_h = fb_height; quad_count = 0; }
+
+static void push_quad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, unsigned int rgba) {
+    if(quad_count >= HUD_MAX_QUADS) return;
+    HudVertex* v = &verts[quad_count++*6];
+    v[0] = (HudVertex){x0,y0,u0,v0,rgba}; v[1] = (HudVertex){x0,y1,u0,v1,rgba}; v[2] = (HudVertex){x1,y1,u1,v1,rgba};
+    v[3] = (HudVertex){x0,y0,u0,v0,rgba}; v[4] = (HudVertex){x1,y1,u1,v1,rgba}; v[5] = (HudVertex){x1,y0,u1,v0,rgba};
+}
+
+void hud_text(float x, float y, float size, unsigned int rgba, const char* text) {
+    float s = size/7.0f, pad = (float)FONT_PAD/FONT_SCALE*s;
+    float cw = (float)CELL_W/FONT_SCALE*s, ch = (float)CELL_H/FONT_SCALE*s, pen = x;
+    for(const char* p = text; *p; p++) {
+        int c = (unsigned char)*p;
+        if(c == '\n') { pen = x; y += 10.0f*s; continue; }
+        if(c >= 'a' && c <= 'z') c -= 32;
+        if(c < 32 || c > 127) c = '?';
+        if(c != ' ') {
+            int g = c-32;
+            float u0 = (float)((g%ATLAS_COLS)*CELL_W)/ATLAS_W, v0 = (float)((g/ATLAS_COLS)*CELL_H)/ATLAS_H;
+            push_quad(pen-pad, y-pad, pen-pad+cw, y-pad+ch, u0, v0, u0+(float)CELL_W/ATLAS_W, v0+(float)CELL_H/ATLAS_H, rgba);
+        }
+        pen += 6.0f*s;
+    }
+}
+
+float hud_text_width(float size, const char* text) { return strlen(text)*6.0f*size/7.0f; }
+
+void hud_rect(float x, float y, float w, float h, unsigned int rgba) {
+    int g = SOLID_GLYPH-32;
+    float u = ((g%ATLAS_COLS)*CELL_W + CELL_W*0.3f)/ATLAS_W, v = ((g/ATLAS_COLS)*CELL_H + CELL_H*0.4f)/ATLAS_H;
+    push_quad(x, y, x+w, y+h, u, v, u, v, rgba);
+}
+
+int hud_glyph_count() { return quad_count; }
+
+void hud_draw() {
+    if(quad_count == 0) return;
+    float size[2] = { (float)hud_w, (float)hud_h };
+    rc_vertex_array(hud_vao);
+    rc_buffer(RC_ARRAY_BUFFER, hud_vbo, -1, quad_count*6*sizeof(HudVertex), verts);
+    rc_program(hud_prog);
+    rc_uniform(size_loc, RC_VEC2, 1, size);
+    rc_texture(0, RC_TEX_2D, hud_atlas);
+    rc_blend(1);
+    rc_draw(0, quad_count*6, 0);
+    rc_blend(0);
+}
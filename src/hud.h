@@ -0,0 +1,18 @@
+#ifndef HUD_H
+#define HUD_H
+
+// Text/HUD overlay. Glyphs come from a signed-distance-field atlas built at
+// startup from an embedded 5x7 font; everything queued between hud_begin()
+// and hud_draw() goes into one dynamic vertex buffer and one draw call.
+
+int hud_init(unsigned int program);
+void hud_begin(int fb_width, int fb_height);
+void hud_text(float x, float y, float size, unsigned int rgba, const char* text);
+void hud_rect(float x, float y, float w, float h, unsigned int rgba);
+float hud_text_width(float size, const char* text);
+void hud_draw();
+int hud_glyph_count();
+
+#define HUD_RGBA(r,g,b,a) ((unsigned int)(r) | (unsigned int)(g)<<8 | (unsigned int)(b)<<16 | (unsigned int)(a)<<24)
+
+#endif
@@ -0,0 +1,62 @@
+#include "image_write.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned int crc_table[256]; static int crc_ready = 0;
+
+static unsigned int crc32_update(unsigned int crc, const unsigned char* p, size_t n) {
+    if(!crc_ready) {
+        for(unsigned int i=0; i<256; i++) { unsigned int c=i; for(int k=0; k<8; k++) c = (c&1) ? 0xEDB88320u^(c>>1) : c>>1; crc_table[i]=c; }
+        crc_ready = 1;
+    }
+    for(size_t i=0; i<n; i++) crc = crc_table[(crc^p[i])&0xFF] ^ (crc>>8);
+    return crc;
+}
+
+static void put32(unsigned char* p, unsigned int v) { p[0]=v>>24; p[1]=v>>16; p[2]=v>>8; p[3]=v; }
+
+static void write_chunk(FILE* f, const char* type, const unsigned char* data, unsigned int len) {
+    unsigned char hdr[8]; put32(hdr, len); memcpy(hdr+4, type, 4);
+    unsigned int crc = crc32_update(0xFFFFFFFFu, hdr+4, 4);
+    crc = crc32_update(crc, data, len) ^ 0xFFFFFFFFu;
+    unsigned char tail[4]; put32(tail, crc);
+    fwrite(hdr, 1, 8, f); fwrite(data, 1, len, f); fwrite(tail, 1, 4, f);
+}
+
+int write_png(const char* path, int w, int h, int comp, const unsigned char* data, int flip_y) {
+    if(comp!=3 && comp!=4) return -1;
+    size_t row = (size_t)w*comp, raw = (size_t)h*(row+1);
+    size_t blocks = (raw+65534)/65535, zlen = 2 + raw + 5*blocks + 4;
+    unsigned char* z = malloc(zlen); if(!z) return -1;
+
+    unsigned char* o = z; *o++ = 0x78; *o++ = 0x01;
+    unsigned int a = 1, b = 0; size_t left = raw, in_block = 0;
+    for(int y=0; y<h; y++) {
+        const unsigned char* src = data + (size_t)(flip_y ? h-1-y : y)*row;
+        for(size_t i=0; i<=row; i++) {
+            if(in_block==0) {
+                size_t n = left<65535 ? left : 65535;
+                *o++ = (left==n); *o++ = n&0xFF; *o++ = n>>8; *o++ = ~n&0xFF; *o++ = (~n>>8)&0xFF;
+                in_block = n;
+            }
+            unsigned char c = i==0 ? 0 : src[i-1];
+            *o++ = c; a = (a+c)%65521; b = (b+a)%65521;
+            in_block--; left--;
+        }
+    }
+    put32(o, (b<<16)|a);
+
+    FILE* f = fopen(path, "wb");
+    if(!f) { printf("GRESKA: Nije moguce upisati fajl: %s\n", path); free(z); return -1; }
+    static const unsigned char sig[8] = {0x89,'P','N','G','\r','\n',0x1A,'\n'};
+    unsigned char ihdr[13]; put32(ihdr, w); put32(ihdr+4, h);
+    ihdr[8]=8; ihdr[9]=comp==4 ? 6 : 2; ihdr[10]=0; ihdr[11]=0; ihdr[12]=0;
+    fwrite(sig, 1, 8, f);
+    write_chunk(f, "IHDR", ihdr, 13);
+    write_chunk(f, "IDAT", z, (unsigned int)zlen);
+    write_chunk(f, "IEND", NULL, 0);
+    fclose(f); free(z);
+    return 0;
+}
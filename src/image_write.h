@@ -0,0 +1,7 @@
+#ifndef IMAGE_WRITE_H
+#define IMAGE_WRITE_H
+
+// Uncompressed (stored deflate) PNG, 3 or 4 channels. flip_y=1 for glReadPixels data.
+int write_png(const char* path, int w, int h, int comp, const unsigned char* data, int flip_y);
+
+#endif
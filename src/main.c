@@ -6,13 +6,31 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <math.h>
 #include <time.h>
+#include <string.h>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <cglm/cglm.h>
 
+#include "image_write.h"
+#include "capture.h"
+#include "cube.h"
+#include "wall.h"
+#include "hud.h"
+#include "swr.h"
+#include "scene.h"
+#include "render.h"
+#include "sim.h"
+#include "control.h"
+#include "shmstate.h"
+#include "audio.h"
+#ifdef RUBIK_HEADLESS
+#include "headless.h"
+#endif
+
 const unsigned int SCR_WIDTH = 1024;
 const unsigned int SCR_HEIGHT = 768;
 
@@ -23,7 +41,38 @@ int game_state = 0;
 int total_moves = 0;
 int postProcessEffect = 0;
 
-ma_engine audio_engine;
+int no_audio = 0;
+int headless = 0;
+int wall_bench = 0;
+int software = 0, software_threads = 0, null_render = 0;
+const char* capture_path = NULL; int capture_scene = 0, capture_fps = 60;
+
+int low_latency = 0, finish_frames = 0, latency_report = 0;
+// input_time is the first input not yet on screen and input_seq the number it got in the input
+// ring; its latency is taken at the first present of a snapshot that has applied it.
+double input_time = -1.0; unsigned int inputs_sent = 0, input_seq = 0;
+double frame_cost = 0.004, refresh_period = 1.0/60.0;
+double latency_sum = 0.0, latency_max = 0.0; int latency_frames = 0;
+
+double app_time() {
+#ifdef RUBIK_HEADLESS
+    if(headless) return headless_time();
+#endif
+    if(null_render) { struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+    return glfwGetTime();
+}
+
+void wait_until(double t) {
+    double left = t - app_time();
+#ifdef _WIN32
+    if(left > 0.002) Sleep((DWORD)((left-0.001)*1000.0));
+#else
+    if(left > 0.002) { struct timespec ts = {0, (long)((left-0.001)*1e9)}; nanosleep(&ts, NULL); }
+#endif
+    while(app_time() < t) {}
+}
+
+void mark_input() { if(input_time < 0) { input_time = glfwGetTime(); input_seq = inputs_sent + 1; } }
 
 void printHelp() {
     printf("\n");
@@ -34,7 +83,9 @@ void printHelp() {
     printf(" [ GLAVNE OPCIJE ]\n");
     printf("   [S]       -> Promesaj kocku (Shuffle)\n");
     printf("   [SPACE]   -> Automatsko resavanje (Auto Solve)\n");
+    printf("   [Z] / [Y] -> Ponisti / ponovi potez (Undo / Redo)\n");
     printf("   [H]       -> Prikazi ovu pomoc\n");
+    printf("   [F1]      -> Ukljuci/iskljuci HUD\n");
     printf("   [ESC]     -> Izlaz iz programa\n");
     printf("-------------------------------------------------------\n");
 
@@ -53,152 +104,544 @@ void printHelp() {
 
 }
 
-char* readFile(const char* path) {
-    FILE* file = fopen(path, "rb");
-    if (!file) { printf("GRESKA: Nije moguce otvoriti fajl: %s\n", path); return NULL; }
-    fseek(file, 0, SEEK_END); long length = ftell(file); fseek(file, 0, SEEK_SET);
-    char* buffer = malloc(length + 1); fread(buffer, 1, length, file);
-    buffer[length] = '\0'; fclose(file); return buffer;
-}
-
-unsigned int createShader(const char* source, GLenum type) {
-    unsigned int shader = glCreateShader(type); glShaderSource(shader, 1, &source, NULL); glCompileShader(shader);
-    int success; char infoLog[512]; glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    if (!success) { glGetShaderInfoLog(shader, 512, NULL, infoLog); printf("Shader Error: %s\n", infoLog); }
-    return shader;
-}
-
-unsigned int createProgram(const char* vPath, const char* fPath) {
-    char* vSource = readFile(vPath); char* fSource = readFile(fPath);
-    if (!vSource || !fSource) return 0;
-    unsigned int vShader = createShader(vSource, GL_VERTEX_SHADER);
-    unsigned int fShader = createShader(fSource, GL_FRAGMENT_SHADER);
-    unsigned int program = glCreateProgram();
-    glAttachShader(program, vShader); glAttachShader(program, fShader); glLinkProgram(program);
-    glDeleteShader(vShader); glDeleteShader(fShader); free(vSource); free(fSource);
-    return program;
-}
-
-unsigned int loadTexture(char const * path) {
-    unsigned int textureID; glGenTextures(1, &textureID);
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format = (nrComponents == 1) ? GL_RED : (nrComponents == 3 ? GL_RGB : GL_RGBA);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        stbi_image_free(data);
-    } else { printf("Texture failed: %s\n", path); stbi_image_free(data); }
-    return textureID;
-}
-
-unsigned int loadCubemap(char** faces) {
-    unsigned int textureID; glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < 6; i++) {
-        unsigned char *data = stbi_load(faces[i], &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        } else stbi_image_free(data);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    return textureID;
-}
+int fb_width = 1024, fb_height = 768;
+int show_hud = 1, show_help_overlay = 0;
+float frame_ms[120]; int frame_ms_head = 0; double hud_cost = 0.0;
+RenderStateStats frame_state;  // GL state changes of the last frame, issued vs skipped by the cache
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) { glViewport(0, 0, width, height); }
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) { glViewport(0, 0, width, height); fb_width = width; fb_height = height; }
 
-typedef struct { char axis; int layer; float dir; } Move;
-Move history[2000]; int history_count = 0;
-int animating = 0, solving = 0, shuffling = 0, shuffle_moves = 0;
-float anim_angle = 0.0f, anim_dir = 1.0f; char anim_axis = 'y'; int anim_layer = 0;
-float animation_speed = 9.0f;
+void record_frame_time(double seconds) { frame_ms[frame_ms_head] = (float)(seconds*1000.0); frame_ms_head = (frame_ms_head+1)%120; }
+
+Cube cube;
 float cube_yaw = 45.0f, cube_pitch = -30.0f, cam_dist = 8.0f;
 double last_x, last_y; int first_mouse = 1;
 
-typedef struct { vec3 colors[6]; } Cubie;
-Cubie cubies[3][3][3]; mat4 cubie_mats[3][3][3];
-
-void init_cubes() {
-    float cols[6][3] = {{0,0.6,0}, {0,0,0.8}, {0.8,0,0}, {1,0.5,0}, {0.9,0.9,0.9}, {0.9,0.9,0}};
-    float blk[3] = {0.1,0.1,0.1};
-    for(int x=0; x<3; x++) for(int y=0; y<3; y++) for(int z=0; z<3; z++) {
-        glm_mat4_identity(cubie_mats[x][y][z]);
-        glm_translate(cubie_mats[x][y][z], (vec3){(float)x-1, (float)y-1, (float)z-1});
-        for(int f=0; f<6; f++) glm_vec3_copy(blk, cubies[x][y][z].colors[f]);
-        if(z==0) glm_vec3_copy(cols[0], cubies[x][y][z].colors[0]);
-        if(z==2) glm_vec3_copy(cols[1], cubies[x][y][z].colors[1]);
-        if(x==0) glm_vec3_copy(cols[2], cubies[x][y][z].colors[2]);
-        if(x==2) glm_vec3_copy(cols[3], cubies[x][y][z].colors[3]);
-        if(y==0) glm_vec3_copy(cols[4], cubies[x][y][z].colors[4]);
-        if(y==2) glm_vec3_copy(cols[5], cubies[x][y][z].colors[5]);
-    }
+// The render side draws from `shown`; cube, sessions, game state and the sim_* camera below
+// belong to the simulation (its own thread in the windowed single-cube mode, unless
+// --low-latency steps it right after the late input poll).
+SimInputQueue sim_inputs; SimTripleBuffer snapshots; const SimSnapshot* shown = NULL;
+int sim_threaded = 0; unsigned int inputs_applied = 0; unsigned int sounds_queued = 0, sounds_played = 0;
+float sim_yaw = 45.0f, sim_pitch = -30.0f;
+
+void play_move_sound() {
+    sounds_queued++;
 }
 
-void rotate_layer_fixed(char axis, int layer, float angle) {
-    mat4 rot; glm_mat4_identity(rot); vec3 ax = {0};
-    if(axis=='x') ax[0]=1; if(axis=='y') ax[1]=1; if(axis=='z') ax[2]=1;
-    glm_rotate(rot, angle, ax);
-    for(int x=0; x<3; x++) for(int y=0; y<3; y++) for(int z=0; z<3; z++) {
-        vec4 pos = {0,0,0,1}; glm_mat4_mulv(cubie_mats[x][y][z], (vec4){0,0,0,1}, pos);
-        int in = 0; float eps = 0.1f;
-        if(axis=='x' && fabsf(pos[0]-(float)layer)<eps) in=1;
-        if(axis=='y' && fabsf(pos[1]-(float)layer)<eps) in=1;
-        if(axis=='z' && fabsf(pos[2]-(float)layer)<eps) in=1;
-        if(in) { mat4 t; glm_mat4_mul(rot, cubie_mats[x][y][z], t); glm_mat4_copy(t, cubie_mats[x][y][z]); }
+SessionWriter session; SessionReader replay; SessionRecord replay_rec;
+const char* record_path = NULL; const char* replay_path = NULL;
+int replaying = 0, replay_more = 0, replay_fast = 0, fixed_step = 0, camera_moved = 0;
+FILE* timings_file = NULL; int shuffle_length = 20; float turbo_budget = 5.0f;
+long long sim_frame = 0; unsigned int rng_seed = 0; double replay_start = 0.0;
+MoveCode* expected_moves = NULL; int expected_head = 0, expected_count = 0, expected_cap = 0; long replay_divergence = 0;
+MoveCode remote_echo = MOVE_NONE; const char* control_path = NULL;
+const char* shm_path = NULL; unsigned int moves_made = 0, shm_version = 0;
+
+void set_cube_size(int n) {
+    if(cube.count && cube.n == n) return;
+    cube_free(&cube);
+    if(cube_init(&cube, n) != 0) { printf("GRESKA: nema memorije za kocku %dx%dx%d\n", n, n, n); exit(1); }
+    cube.turbo_budget = turbo_budget;
+}
+
+double sim_time() { return fixed_step ? sim_frame/60.0 : app_time(); }
+
+// Moves recorded for the current frame, grown to the largest turbo step; expected_head is the next one due.
+void expect_move(MoveCode m) {
+    if(expected_count == expected_cap) {
+        int cap = expected_cap ? expected_cap*2 : 64;
+        MoveCode* p = realloc(expected_moves, sizeof(MoveCode)*cap);
+        if(!p) return;
+        expected_moves = p; expected_cap = cap;
     }
+    expected_moves[expected_count++] = m;
+}
+
+void check_replay_move(MoveCode m) {
+    if(expected_head < expected_count && expected_moves[expected_head] == m) { expected_head++; return; }
+    replay_divergence++;
+}
+
+void note_move(MoveCode m) {
+    play_move_sound(); moves_made++;
+    if(session.f) session_move(&session, m, sim_frame, app_time());
+    if(replaying && remote_echo == MOVE_NONE) check_replay_move(m);
 }
 
 void trigger(char ax, int l, float d, int rec) {
-    animating=1; anim_axis=ax; anim_layer=l; anim_dir=d; anim_angle=0;
-    if(rec && history_count<2000) { history[history_count++] = (Move){ax, l, d}; if(game_state == 2) total_moves++; }
-    ma_engine_play_sound(&audio_engine, "res/sounds/move.wav", NULL);
+    if(cube_trigger(&cube, ax, l, d, rec) && game_state == 2) total_moves++;
+    note_move(cube.last_move);
+}
+
+void remote_apply(MoveCode m) {
+    Move mv; move_decode(m, &mv.axis, &mv.layer, &mv.dir);
+    trigger(mv.axis, mv.layer, mv.dir, 1);
+}
+
+// Moves from the control socket; recorded as input so a replay performs them again.
+int remote_move(MoveCode m) {
+    if(replaying) return 0;
+    if(session.f) { unsigned char p[2] = { (unsigned char)(m & 0xFF), (unsigned char)(m >> 8) }; session_record(&session, SESSION_REMOTE, p, 2, sim_frame, app_time()); }
+    remote_apply(m);
+    return 1;
+}
+
+void key_action(int k) {
+    if(k==GLFW_KEY_1) postProcessEffect = 0;
+    if(k==GLFW_KEY_2) postProcessEffect = 1;
+    if(k==GLFW_KEY_3) postProcessEffect = 2;
+    if(k==GLFW_KEY_4) postProcessEffect = 3;
+
+    // Turns are queued even while a layer is still animating; only auto shuffle/solve lock the cube.
+    if(!cube.shuffling && !cube.solving) {
+        int top = cube.n-1;
+        if(k==GLFW_KEY_I) trigger('y', top, -1, 1); if(k==GLFW_KEY_K) trigger('y', 0, 1, 1);
+        if(k==GLFW_KEY_J) trigger('x', 0, 1, 1); if(k==GLFW_KEY_L) trigger('x', top, -1, 1);
+        if(k==GLFW_KEY_U) trigger('z', top, -1, 1); if(k==GLFW_KEY_O) trigger('z', 0, 1, 1);
+        if(k==GLFW_KEY_Z && cube_undo(&cube)) note_move(cube.last_move);
+        if(k==GLFW_KEY_Y && cube_redo(&cube)) note_move(cube.last_move);
+    }
+    if(!cube.animating) {
+        if(k==GLFW_KEY_S && !cube.shuffling && !cube.solving) { cube_shuffle(&cube, shuffle_length); game_state=1; total_moves=0; }
+        if(k==GLFW_KEY_SPACE && cube.history.count>0 && !cube.shuffling) { cube_solve(&cube); game_state=3; }
+    }
+}
+
+void input_key(int k) {
+    if(replaying) return;
+    if(session.f) { unsigned char p[2] = { (unsigned char)(k & 0xFF), (unsigned char)(k >> 8) }; session_record(&session, SESSION_KEY, p, 2, sim_frame, app_time()); }
+    key_action(k);
+}
+
+void record_camera() {
+    if(!session.f || !camera_moved) return;
+    float p[2] = { sim_yaw, sim_pitch };
+    session_record(&session, SESSION_CAMERA, p, sizeof(p), sim_frame, app_time());
+    camera_moved = 0;
+}
+
+void start_replay() {
+    if(session_open(&replay, replay_path) != 0) return;
+    replaying = 1; replay_more = session_next(&replay, &replay_rec);
+    fixed_step = 1; sim_frame = 0; replay_start = app_time();
+    printf("Reprodukcija: %s (%zu bajtova, %s, %s)\n", replay_path, replay.size, replay.mapped ? "mmap" : "ucitano", replay_fast ? "maksimalna brzina" : "realno vreme");
+}
+
+void finish_replay() {
+    replaying = 0; session_release(&replay);
+    free(expected_moves); expected_moves = NULL; expected_cap = 0;
+    printf("Reprodukcija zavrsena: %lld frejmova, %.2f s, odstupanja: %ld\n", sim_frame, app_time()-replay_start, replay_divergence);
+}
+
+void replay_frame() {
+    if(!replay_fast) wait_until(replay_start + sim_frame/60.0);
+    int keys[32], key_count = 0;
+    while(replay_more && replay_rec.frame <= sim_frame) {
+        const unsigned char* p = replay_rec.payload;
+        // A remote move is applied on the spot (after the keys read before it) and its own move record checked against it.
+        if(replay_rec.move != MOVE_NONE && remote_echo != MOVE_NONE) { if(replay_rec.move != remote_echo) replay_divergence++; remote_echo = MOVE_NONE; }
+        else if(replay_rec.move != MOVE_NONE) expect_move(replay_rec.move);
+        else if(replay_rec.code == SESSION_REMOTE) {
+            for(int i=0; i<key_count; i++) key_action(keys[i]);
+            key_count = 0; remote_echo = (MoveCode)(p[0] | p[1]<<8);
+            remote_apply(remote_echo);
+        }
+        else if(replay_rec.code == SESSION_SIZE) set_cube_size(p[0] | p[1]<<8);
+        else if(replay_rec.code == SESSION_CAMERA) { memcpy(&sim_yaw, p, 4); memcpy(&sim_pitch, p+4, 4); }
+        else if(replay_rec.code == SESSION_SEED) { memcpy(&rng_seed, p, 4); srand(rng_seed); }
+        else if(replay_rec.code == SESSION_SETTINGS) { memcpy(&shuffle_length, p, 4); memcpy(&turbo_budget, p+4, 4); cube.turbo_budget = turbo_budget; }
+        else if(replay_rec.code == SESSION_KEY && key_count < 32) keys[key_count++] = p[0] | p[1]<<8;
+        replay_more = session_next(&replay, &replay_rec);
+    }
+    for(int i=0; i<key_count; i++) key_action(keys[i]);
+}
+
+void end_replay_frame() {
+    replay_divergence += expected_count - expected_head; expected_head = expected_count = 0;
+    if(!replay_more && !cube.animating && !cube.shuffling && !cube.solving) finish_replay();
+}
+
+void log_timing(double update, double render, double total) {
+    if(timings_file) fprintf(timings_file, "%lld,%.4f,%.4f,%.4f,%llu,%llu\n", shown->frame-1, update*1000.0, render*1000.0, total*1000.0, frame_state.issued, frame_state.skipped);
+}
+
+void send_input(int type, int key) {
+    SimInput in = { type, key, cube_yaw, cube_pitch };
+    if(sim_input_push(&sim_inputs, &in) == 0) inputs_sent++;
+    else if(type == SIM_INPUT_KEY) printf("Red ulaza pun, taster odbacen\n");
 }
 
 void key_cb(GLFWwindow* w, int k, int s, int a, int m) {
     if(a==GLFW_PRESS) {
+        mark_input();
         if(k==GLFW_KEY_ESCAPE) glfwSetWindowShouldClose(w, 1);
-        if(k==GLFW_KEY_H) printHelp();
-        if(k==GLFW_KEY_1) postProcessEffect = 0;
-        if(k==GLFW_KEY_2) postProcessEffect = 1;
-        if(k==GLFW_KEY_3) postProcessEffect = 2;
-        if(k==GLFW_KEY_4) postProcessEffect = 3;
-
-        if(!animating) {
-            if(k==GLFW_KEY_I) trigger('y', 1, -1, 1); if(k==GLFW_KEY_K) trigger('y', -1, 1, 1);
-            if(k==GLFW_KEY_J) trigger('x', -1, 1, 1); if(k==GLFW_KEY_L) trigger('x', 1, -1, 1);
-            if(k==GLFW_KEY_U) trigger('z', 1, -1, 1); if(k==GLFW_KEY_O) trigger('z', -1, 1, 1);
-            if(k==GLFW_KEY_S && !shuffling && !solving) { shuffling=1; shuffle_moves=20; game_state=1; total_moves=0; }
-            if(k==GLFW_KEY_SPACE && history_count>0 && !shuffling) { solving=1; game_state=3; }
-        }
+        if(k==GLFW_KEY_H) { printHelp(); show_help_overlay = !show_help_overlay; }
+        if(k==GLFW_KEY_F1) show_hud = !show_hud;
+        send_input(SIM_INPUT_KEY, k);
     }
 }
 
 void mouse_cb(GLFWwindow* w, double x, double y) {
+    if(shown->replaying) return;
     if(glfwGetMouseButton(w, GLFW_MOUSE_BUTTON_LEFT)==GLFW_PRESS) {
         if(first_mouse) { last_x=x; last_y=y; first_mouse=0; }
+        mark_input();
         cube_yaw += (x-last_x)*0.5f; cube_pitch += (last_y-y)*0.5f;
         last_x=x; last_y=y;
         if(cube_pitch>89) cube_pitch=89; if(cube_pitch<-89) cube_pitch=-89;
+        send_input(SIM_INPUT_CAMERA, 0);
     } else first_mouse=1;
 }
 
-const char* skyboxVertSrc = "#version 330 core\nlayout (location=0) in vec3 aPos;\nout vec3 TexCoords;\nuniform mat4 projection;\nuniform mat4 view;\nvoid main(){\nTexCoords=aPos;\ngl_Position=(projection*view*vec4(aPos,1.0)).xyww;\n}\0";
-const char* skyboxFragSrc = "#version 330 core\nout vec4 FragColor;\nin vec3 TexCoords;\nuniform samplerCube skybox;\nvoid main(){\nFragColor=texture(skybox,TexCoords);\n}\n\0";
+void init_scene() {
+    scene_init(SCR_WIDTH, SCR_HEIGHT);
+    if(software && scene_software(software_threads) != 0) { printf("GRESKA: softverski renderer nije pokrenut, koristi se OpenGL\n"); software = 0; }
+    if(software) printf("Softverski renderer: %d niti\n", swr_threads());
+}
+
+void update_cube() {
+    if(wall_count>0) { wall_step(); sim_frame++; return; }
+    record_camera();
+    if(replaying) replay_frame();
+    int ev = cube_step(&cube);
+    if(ev & CUBE_EV_MOVE) for(int i=0; i<cube.step_count; i++) note_move(cube.step_moves[i]);
+    if(ev & CUBE_EV_SHUFFLED) { game_state=2; start_time=sim_time(); }
+    if((ev & CUBE_EV_IDLE) && game_state==2 && cube.history.count==0) { game_state=0; final_time = sim_time()-start_time; }
+    sim_frame++;
+    if(replaying) end_replay_frame();
+}
 
-int main() {
-    srand(time(NULL)); init_cubes();
-    if (ma_engine_init(NULL, &audio_engine) != MA_SUCCESS) return -1;
+void publish_snapshot() {
+    SimSnapshot* s = sim_back(&snapshots);
+    // Out of memory keeps showing the last snapshot that fit.
+    if(sim_snapshot_reserve(s, cube.n) != 0) { static int warned; if(!warned++) printf("GRESKA: nema memorije za snimak stanja %dx%dx%d\n", cube.n, cube.n, cube.n); return; }
+    if(s->n != cube.n || s->version != cube.view_version) { cube_stickers(&cube, 0, s->stickers); s->n = cube.n; s->version = cube.view_version; }
+    s->anim_axis = cube.anim_moves ? cube.anim_axis-'x' : -1;
+    for(int i=0; i<cube.n; i++) s->anim_angles[i] = cube.anim_moves ? glm_rad(cube.anim_angle*cube.anim_turns[i]) : 0.0f;
+    s->frame = sim_frame; s->time = sim_time();
+    s->game_state = game_state; s->total_moves = total_moves; s->effect = postProcessEffect;
+    s->start_time = start_time; s->final_time = final_time;
+    s->replaying = replaying; s->busy = cube.animating || cube.shuffling || cube.solving;
+    s->turbo_rate = cube.turbo_rate; s->turbo_done = cube.turbo_done; s->turbo_total = cube.turbo_total;
+    s->yaw = sim_yaw; s->pitch = sim_pitch; s->sounds = sounds_queued; s->inputs = inputs_applied;
+    SharedCubeState* sh = shm_state_begin(cube.n);
+    if(sh) {
+        sh->n = cube.n; sh->game_state = game_state; sh->anim_axis = s->anim_axis;
+        sh->flags = (cube.animating ? CUBE_SHM_ANIMATING : 0) | (cube.shuffling ? CUBE_SHM_SHUFFLING : 0) | (cube.solving ? CUBE_SHM_SOLVING : 0) | (replaying ? CUBE_SHM_REPLAYING : 0);
+        sh->total_moves = (unsigned int)total_moves; sh->history = (unsigned int)cube.history.count; sh->moves_done = moves_made;
+        sh->frame = sim_frame; sh->time = s->time; sh->start_time = start_time; sh->final_time = final_time;
+        sh->anim_progress = cube.anim_moves ? cube.anim_angle/90.0f : 0.0f;
+        memcpy(shm_state_angles(sh), s->anim_angles, sizeof(float)*cube.n);
+        if(shm_version != s->version) { memcpy(shm_state_stickers(sh), s->stickers, 6*(size_t)cube.n*cube.n); shm_version = s->version; }
+        shm_state_end();
+    }
+    sim_publish(&snapshots);
+}
+
+// One simulation step: queued input first, then the cube, then a fresh snapshot. Returns 0
+// while a fast replay wants the next step right away.
+int sim_tick() {
+    SimInput in;
+    while(sim_input_pop(&sim_inputs, &in)) {
+        inputs_applied++;
+        if(in.type == SIM_INPUT_KEY) input_key(in.key);
+        else if(!replaying) { sim_yaw = in.yaw; sim_pitch = in.pitch; camera_moved = 1; }
+    }
+    control_poll(&cube, CONTROL_TICK_BUDGET, remote_move);
+    update_cube();
+    publish_snapshot();
+    return !(replaying && replay_fast);
+}
+
+// Render-side frame start: steps the simulation itself unless it has its own thread, then
+// takes the newest snapshot. A replay drives the camera and queued move sounds are played.
+void advance_frame() {
+    if(!sim_threaded) sim_tick();
+    shown = sim_latest(&snapshots);
+    if(shown->replaying) { cube_yaw = shown->yaw; cube_pitch = shown->pitch; }
+    for(int i=0; sounds_played != shown->sounds; sounds_played++) if(i++ < AUDIO_MAX_PER_FRAME) audio_play();
+}
+
+void draw_hud() {
+    if(!show_hud) return;
+    double t0 = app_time();
+    unsigned int white = HUD_RGBA(255,255,255,255), grey = HUD_RGBA(180,180,180,255);
+    char buf[128];
+    hud_begin(fb_width, fb_height);
+
+    int state_id = shown->game_state;
+    double t = state_id==2 ? (fixed_step ? shown->time : app_time())-shown->start_time : shown->final_time;
+    const char* state = state_id==1 ? "MESANJE" : state_id==2 ? "U TOKU" : state_id==3 ? "RESAVANJE" : "SPREMNO";
+    float avg = 0; for(int i=0; i<120; i++) avg += frame_ms[i]; avg /= 120.0f;
+    hud_rect(10, 10, 260, 170, HUD_RGBA(0,0,0,150));
+    snprintf(buf, sizeof(buf), "VREME   %02d:%05.2f", (int)(t/60), fmod(t, 60.0)); hud_text(20, 20, 14, white, buf);
+    snprintf(buf, sizeof(buf), "POTEZI  %d", shown->total_moves); hud_text(20, 42, 14, white, buf);
+    snprintf(buf, sizeof(buf), "POTEZ/S %.2f", t>0 ? shown->total_moves/t : 0.0); hud_text(20, 64, 14, white, buf);
+    hud_text(20, 86, 14, HUD_RGBA(255,210,80,255), state);
+    if(shown->turbo_rate && shown->turbo_total) {
+        float p = (float)shown->turbo_done / shown->turbo_total;
+        snprintf(buf, sizeof(buf), "TURBO %3.0f%%", p*100.0f); hud_text(150, 89, 11, white, buf);
+        hud_rect(150, 104, 110*p, 3, HUD_RGBA(255,210,80,255));
+    }
+    snprintf(buf, sizeof(buf), "FPS %.0f  %.2f MS  HUD %.3f MS", avg>0 ? 1000.0f/avg : 0.0f, avg, hud_cost*1000.0); hud_text(20, 108, 9, grey, buf);
+    for(int i=0; i<120; i++) {
+        float ms = frame_ms[(frame_ms_head+i)%120], h = fminf(ms*2.0f, 44.0f);
+        unsigned int col = ms <= 17.0f ? HUD_RGBA(80,220,80,220) : ms <= 34.0f ? HUD_RGBA(240,200,60,220) : HUD_RGBA(240,70,60,220);
+        hud_rect(20.0f + i*2.0f, 170.0f - h, 1.5f, h, col);
+    }
+    hud_rect(20, 170.0f - 1000.0f/60.0f*2.0f, 240, 1, HUD_RGBA(255,255,255,90));
+
+    if(show_help_overlay) {
+        static const char* help =
+            "S      PROMESAJ\nSPACE  AUTOMATSKO RESAVANJE\nZ / Y  PONISTI / PONOVI\nI / K  Y OSA\nJ / L  X OSA\nU / O  Z OSA\n"
+            "1-4    POST-PROCESSING EFEKTI\nF1     HUD\nH      POMOC\nESC    IZLAZ";
+        hud_rect(fb_width-300.0f, 10, 290, 185, HUD_RGBA(0,0,0,150));
+        hud_text(fb_width-290.0f, 20, 11, white, help);
+    }
+    hud_draw();
+    hud_cost = hud_cost*0.95 + (app_time()-t0)*0.05;
+}
+
+void render_scene(unsigned int target, float timeVal) {
+    RenderStateStats before = rc_state_stats;
+    SceneFrame f = { .n = shown->n, .version = shown->version, .anim_axis = shown->anim_axis, .effect = shown->effect,
+                     .stickers = shown->stickers, .anim_angles = shown->anim_angles };
+    scene_camera(&f, cube_yaw, cube_pitch, cam_dist, timeVal);
+    scene_draw(&f, target, fb_width, fb_height);
+    draw_hud();
+    frame_state.issued = rc_state_stats.issued - before.issued; frame_state.skipped = rc_state_stats.skipped - before.skipped;
+}
+
+int set_wall_size(int n) {
+    if(wall_init(n) != 0) { printf("GRESKA: nema memorije za zid od %d kocki\n", n); return -1; }
+    scene_wall_resize(n);
+    cam_dist = fmaxf(8.0f, wall_extent*1.4f); cube_yaw = 0.0f; cube_pitch = 0.0f;
+    return 0;
+}
+
+double wall_frame_ms(unsigned int target, int frames) {
+    for(int i=0; i<5; i++) { advance_frame(); render_scene(target, 0.0f); }
+    glFinish();
+    double t0 = app_time();
+    for(int i=0; i<frames; i++) { advance_frame(); render_scene(target, i/60.0f); }
+    glFinish();
+    return (app_time()-t0)*1000.0/frames;
+}
+
+void wall_benchmark(unsigned int target) {
+    printf("Wall benchmark (%s)\n", (const char*)glGetString(GL_RENDERER));
+    int good = 0, bad = 0, n = wall_count>0 ? wall_count : 16;
+    while(!bad && n <= 65536) {
+        if(set_wall_size(n) != 0) { bad = n; break; }
+        double ms = wall_frame_ms(target, 30);
+        printf("  %6d kocki: %8.3f ms/frejm\n", n, ms);
+        if(ms <= 1000.0/60.0) { good = n; n *= 2; } else bad = n;
+    }
+    while(bad && bad-good > (good/16 > 1 ? good/16 : 1)) {
+        int mid = (good+bad)/2;
+        if(set_wall_size(mid) != 0) { bad = mid; continue; }
+        double ms = wall_frame_ms(target, 30);
+        printf("  %6d kocki: %8.3f ms/frejm\n", mid, ms);
+        if(ms <= 1000.0/60.0) good = mid; else bad = mid;
+    }
+    printf("Odrzivo na 60 FPS: %d kocki (%d kockica)\n", good, good*(wall_count ? wall[0].count : 26));
+    wall_free();
+}
+
+// Logical move throughput vs cube size: random, outer-layer and inner-layer turns applied to
+// the logical layout only (cube_rotate_logical), i.e. the cost of one move. No GL needed.
+void move_benchmark() {
+    static const int sizes[] = {2, 3, 4, 5, 7, 10, 15, 20, 30, 40, 50, 64, 100, 128};
+    enum { MOVES = 1<<16 };
+    MoveCode* moves = malloc(sizeof(MoveCode)*MOVES);
+    if(!moves) return;
+    printf("Move benchmark (%d poteza po merenju)\n     N  kockica   nasumicno      spoljni   unutrasnji\n", MOVES);
+    for(size_t i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++) {
+        int n = sizes[i]; Cube c = {0};
+        if(cube_init(&c, n) != 0) break;
+        double ns[3];
+        for(int kind=0; kind<3; kind++) {
+            for(int m=0; m<MOVES; m++) {
+                int layer = kind==0 ? rand()%n : kind==1 ? (rand()%2)*(n-1) : (n>2 ? 1 + rand()%(n-2) : 0);
+                moves[m] = move_encode("xyz"[rand()%3], layer, (rand()%2)*2-1);
+            }
+            clock_t t0 = clock();
+            for(int m=0; m<MOVES; m++) { char ax; int l; float d; move_decode(moves[m], &ax, &l, &d); cube_rotate_logical(&c, ax, l, (int)d); }
+            ns[kind] = (double)(clock()-t0)/CLOCKS_PER_SEC*1e9/MOVES;
+        }
+        printf("  %4d  %7d  %7.0f ns  %8.0f ns  %8.0f ns   (%.2f M poteza/s)\n", n, c.count, ns[0], ns[1], ns[2], 1000.0/ns[0]);
+        cube_free(&c);
+    }
+    free(moves);
+}
+
+#ifdef RUBIK_HEADLESS
+int run_headless(int frames, const char* dump_dir) {
+    if(headless_init() != 0) return -1;
+    if(!gladLoadGLLoader((GLADloadproc)headless_proc)) { printf("GRESKA: glad nije ucitao OpenGL funkcije\n"); headless_shutdown(); return -1; }
+    printf("Renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+    init_scene();
+
+    unsigned int outFbo, outRbo;
+    glGenFramebuffers(1, &outFbo); glBindFramebuffer(GL_FRAMEBUFFER, outFbo);
+    glGenRenderbuffers(1, &outRbo); glBindRenderbuffer(GL_RENDERBUFFER, outRbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, outRbo);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE) printf("FBO Error!\n");
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+    rc_invalidate();
+    unsigned char* pixels = dump_dir ? malloc(SCR_WIDTH*SCR_HEIGHT*4) : NULL;
+    if(capture_path) capture_start(capture_path, capture_format_for(capture_path), SCR_WIDTH, SCR_HEIGHT, capture_fps);
+
+    if(wall_bench) { wall_benchmark(outFbo); free(pixels); capture_stop(); headless_shutdown(); return 0; }
+    fixed_step = 1;
+    // With a control socket the cube is left to its clients instead of the shuffle/solve loop.
+    int autoplay = !replaying && !control_path;
+    if(autoplay) input_key(GLFW_KEY_S);
+    int limit = frames >= 0 ? frames : (replaying ? 0x7FFFFFFF : 300);
+    double sum=0, best=1e9, worst=0; RenderStateStats state = {0, 0};
+    frames = 0;
+    for(int i=0; i<limit; i++) {
+        double t0 = headless_time();
+        if(autoplay && !cube.animating && !cube.shuffling && !cube.solving && cube.history.count>0) input_key(GLFW_KEY_SPACE);
+        advance_frame();
+        double t1 = headless_time();
+        render_scene(outFbo, (float)shown->time);
+        capture_frame(capture_scene && !software ? scene_framebuffer() : outFbo, SCR_WIDTH, SCR_HEIGHT);
+        glFinish();
+        double dt = headless_time()-t0;
+        record_frame_time(dt); log_timing(t1-t0, dt-(t1-t0), dt); frames++;
+        sum += dt; if(dt<best) best=dt; if(dt>worst) worst=dt;
+        state.issued += frame_state.issued; state.skipped += frame_state.skipped;
+        if(pixels) {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, outFbo);
+            glReadPixels(0, 0, SCR_WIDTH, SCR_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            char path[1024]; snprintf(path, sizeof(path), "%s/frame_%05d.png", dump_dir, i);
+            write_png(path, SCR_WIDTH, SCR_HEIGHT, 4, pixels, 1);
+        }
+        if(replay_path && !replaying) break;
+    }
+    if(frames>0) printf("Headless: %d frejmova, prosek %.3f ms, min %.3f ms, max %.3f ms (%.1f FPS), HUD %.3f ms\n", frames, sum/frames*1000.0, best*1000.0, worst*1000.0, frames/sum, hud_cost*1000.0);
+    if(frames>0 && state.issued+state.skipped) printf("GL stanje po frejmu: %.1f izdato, %.1f preskoceno (%.0f%%)\n", (double)state.issued/frames, (double)state.skipped/frames, 100.0*state.skipped/(state.issued+state.skipped));
+    free(pixels);
+    scene_shutdown(); sim_buffer_free(&snapshots);
+    control_close(); shm_state_close(); capture_stop(); session_close(&session);
+    if(timings_file) fclose(timings_file);
+    headless_shutdown();
+    return 0;
+}
+#endif
+
+// Frames through the null render backend, with no GL context: simulation, camera math and
+// command building only, i.e. what a frame costs before the driver sees it. The same run
+// with --headless shows the driver's share.
+int run_null(int frames) {
+    rc_use(&rc_null);
+    init_scene();
+    fixed_step = 1;
+    int autoplay = !replaying && !control_path;
+    if(autoplay) input_key(GLFW_KEY_S);
+    int limit = frames >= 0 ? frames : (replaying ? 0x7FFFFFFF : 300);
+    double sim_sum=0, sum=0, best=1e9, worst=0;
+    memset(&rc_stats, 0, sizeof(rc_stats));
+    frames = 0;
+    for(int i=0; i<limit; i++) {
+        double t0 = app_time();
+        if(autoplay && !cube.animating && !cube.shuffling && !cube.solving && cube.history.count>0) input_key(GLFW_KEY_SPACE);
+        advance_frame();
+        double t1 = app_time();
+        render_scene(0, (float)shown->time);
+        double dt = app_time()-t0;
+        record_frame_time(dt); log_timing(t1-t0, dt-(t1-t0), dt); frames++;
+        sim_sum += t1-t0; sum += dt; if(dt<best) best=dt; if(dt>worst) worst=dt;
+        if(replay_path && !replaying) break;
+    }
+    if(frames>0) {
+        unsigned long long total = 0;
+        for(int c=0; c<RC_COMMANDS; c++) total += rc_stats.commands[c];
+        printf("Null renderer: %d frejmova, prosek %.3f ms (simulacija %.3f ms, frejm %.3f ms), min %.3f ms, max %.3f ms\n",
+               frames, sum/frames*1000.0, sim_sum/frames*1000.0, (sum-sim_sum)/frames*1000.0, best*1000.0, worst*1000.0);
+        printf("Po frejmu: %.1f komandi, %.2f KB:", (double)total/frames, rc_stats.bytes/1024.0/frames);
+        for(int c=0; c<RC_COMMANDS; c++) if(rc_stats.commands[c]) printf(" %s %.1f", rc_command_name(c), (double)rc_stats.commands[c]/frames);
+        printf("\n");
+    }
+    scene_shutdown(); sim_buffer_free(&snapshots);
+    control_close(); shm_state_close(); session_close(&session);
+    if(timings_file) fclose(timings_file);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int cube_size = 3, move_bench = 0, headless_frames = -1, wall_size = 0, seed_set = 0; const char* timings_path = NULL;
+#ifdef RUBIK_HEADLESS
+    const char* dump_dir = NULL;
+#endif
+    for(int i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--headless")) headless = 1;
+        else if(!strcmp(argv[i], "--frames") && i+1<argc) headless_frames = atoi(argv[++i]);
+#ifdef RUBIK_HEADLESS
+        else if(!strcmp(argv[i], "--dump") && i+1<argc) dump_dir = argv[++i];
+#else
+        else if(!strcmp(argv[i], "--dump")) { printf("GRESKA: --dump radi samo u headless rezimu, a program je preveden bez headless podrske (EGL)\n"); return 1; }
+#endif
+        else if(!strcmp(argv[i], "--capture") && i+1<argc) capture_path = argv[++i];
+        else if(!strcmp(argv[i], "--capture-scene")) capture_scene = 1;
+        else if(!strcmp(argv[i], "--capture-fps") && i+1<argc) capture_fps = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--wall") && i+1<argc) wall_size = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--wall-bench")) wall_bench = 1;
+        else if(!strcmp(argv[i], "--no-audio")) no_audio = 1;
+        else if(!strcmp(argv[i], "--record") && i+1<argc) record_path = argv[++i];
+        else if(!strcmp(argv[i], "--replay") && i+1<argc) replay_path = argv[++i];
+        else if(!strcmp(argv[i], "--replay-fast")) replay_fast = 1;
+        else if(!strcmp(argv[i], "--size") && i+1<argc) {
+            char* end; long v = strtol(argv[++i], &end, 10);
+            if(end == argv[i] || *end || v < 2 || v > CUBE_MAX_N) { printf("GRESKA: --size %s: velicina mora biti broj od 2 do %d\n", argv[i], CUBE_MAX_N); return 1; }
+            cube_size = (int)v;
+        }
+        else if(!strcmp(argv[i], "--move-bench")) move_bench = 1;
+        else if(!strcmp(argv[i], "--turbo") && i+1<argc) turbo_budget = (float)atof(argv[++i]);
+        else if(!strcmp(argv[i], "--shuffle") && i+1<argc) shuffle_length = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--seed") && i+1<argc) { rng_seed = (unsigned int)strtoul(argv[++i], NULL, 10); seed_set = 1; }
+        else if(!strcmp(argv[i], "--timings") && i+1<argc) timings_path = argv[++i];
+        else if(!strcmp(argv[i], "--low-latency")) low_latency = 1;
+        else if(!strcmp(argv[i], "--finish")) finish_frames = 1;
+        else if(!strcmp(argv[i], "--latency")) latency_report = 1;
+        else if(!strcmp(argv[i], "--shm")) shm_path = i+1<argc && argv[i+1][0] == '/' ? argv[++i] : SHM_STATE_DEFAULT_NAME;
+        else if(!strcmp(argv[i], "--null-render")) null_render = 1;
+        else if(!strcmp(argv[i], "--software")) { software = 1; if(i+1<argc && argv[i+1][0] >= '0' && argv[i+1][0] <= '9') software_threads = atoi(argv[++i]); }
+        else if(!strcmp(argv[i], "--socket")) control_path = i+1<argc && argv[i+1][0] != '-' ? argv[++i] : CONTROL_DEFAULT_PATH;
+        else printf("Nepoznata opcija: %s\n", argv[i]);
+    }
+    sim_buffer_init(&snapshots); shown = sim_latest(&snapshots);
+    if(!seed_set) rng_seed = (unsigned int)time(NULL);
+    srand(rng_seed);
+    if(move_bench) { move_benchmark(); return 0; }
+    set_cube_size(cube_size);
+    if(timings_path && (timings_file = fopen(timings_path, "w"))) fprintf(timings_file, "frame,update_ms,render_ms,total_ms,state_issued,state_skipped\n");
+    if(wall_bench && wall_size<=0) wall_size = 16;
+    if(wall_size>0 && set_wall_size(wall_size) != 0) return 1;
+    if(software && wall_size>0) { printf("Softverski renderer crta samo jednu kocku, zid ide kroz OpenGL\n"); software = 0; }
+    if(record_path && session_create(&session, record_path) == 0) {
+        unsigned char size[2] = { (unsigned char)cube.n, 0 };
+        session_record(&session, SESSION_SEED, &rng_seed, 4, 0, app_time());
+        session_record(&session, SESSION_SIZE, size, 2, 0, app_time());
+        unsigned char settings[8]; memcpy(settings, &shuffle_length, 4); memcpy(settings+4, &turbo_budget, 4);
+        session_record(&session, SESSION_SETTINGS, settings, 8, 0, app_time());
+    }
+    if(replay_path) start_replay();
+    if(control_path) control_open(control_path);
+    if(shm_path) shm_state_open(shm_path);
+    if(null_render) {
+        if(wall_bench || capture_path) printf("Null renderer: --wall-bench i --capture traze OpenGL, ignorisano\n");
+        return run_null(headless_frames);
+    }
+    if(headless) {
+#ifdef RUBIK_HEADLESS
+        return run_headless(headless_frames, dump_dir);
+#else
+        printf("GRESKA: program je preveden bez headless podrske (EGL)\n"); return -1;
+#endif
+    }
     glfwInit(); glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3); glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     #ifdef __APPLE__
@@ -208,178 +651,63 @@ int main() {
     glfwMakeContextCurrent(window); glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_cb); glfwSetKeyCallback(window, key_cb);
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) return -1;
-    glEnable(GL_DEPTH_TEST);
-
-    unsigned int cubeProg = createProgram("res/shaders/cube.vert", "res/shaders/cube.frag");
-    unsigned int screenProg = createProgram("res/shaders/screen.vert", "res/shaders/screen.frag");
-
-    unsigned int skyProg = glCreateProgram();
-    unsigned int sv = createShader(skyboxVertSrc, GL_VERTEX_SHADER);
-    unsigned int sf = createShader(skyboxFragSrc, GL_FRAGMENT_SHADER);
-    glAttachShader(skyProg, sv); glAttachShader(skyProg, sf); glLinkProgram(skyProg);
-
-    float vertices[] = {
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-         0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-         0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-         0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
-         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f
-    };
-    unsigned int cubeVAO, cubeVBO;
-    glGenVertexArrays(1, &cubeVAO); glGenBuffers(1, &cubeVBO);
-    glBindVertexArray(cubeVAO); glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0); glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float))); glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float))); glEnableVertexAttribArray(2);
-
-    float quadVerts[] = { -1,1,0,1, -1,-1,0,0, 1,-1,1,0, -1,1,0,1, 1,-1,1,0, 1,1,1,1 };
-    unsigned int quadVAO, quadVBO;
-    glGenVertexArrays(1, &quadVAO); glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO); glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVerts), &quadVerts, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*)0); glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*)(2*sizeof(float))); glEnableVertexAttribArray(1);
-
-    float skyboxVertices[] = { -1,1,-1,-1,-1,-1,1,-1,-1,1,-1,-1,1,1,-1,-1,1,-1,-1,-1,1,-1,-1,-1,-1,1,-1,-1,1,-1,-1,1,1,-1,-1,1,1,-1,-1,1,-1,1,1,1,1,1,1,1,1,1,-1,1,-1,-1,-1,-1,1,-1,1,1,1,1,1,1,1,1,1,-1,1,-1,-1,1,-1,1,-1,1,1,-1,1,1,1,1,1,1,-1,1,1,-1,1,-1,-1,-1,-1,-1,-1,1,1,-1,-1,1,-1,-1,-1,-1,1,1,-1,1 };
-    unsigned int skyVAO, skyVBO;
-    glGenVertexArrays(1, &skyVAO); glGenBuffers(1, &skyVBO);
-    glBindVertexArray(skyVAO); glBindBuffer(GL_ARRAY_BUFFER, skyVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0); glEnableVertexAttribArray(0);
-
-    unsigned int fbo; glGenFramebuffers(1, &fbo); glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    unsigned int texColorBuffer; glGenTextures(1, &texColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, texColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texColorBuffer, 0);
-    unsigned int rbo; glGenRenderbuffers(1, &rbo); glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
-    if(glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE) printf("FBO Error!\n");
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    unsigned int cubeTexture = loadTexture("res/textures/container.jpg");
-    unsigned int normalMap = loadTexture("res/textures/normal_map.png");
-    char* faces[] = {"res/textures/skybox/right.jpg", "res/textures/skybox/left.jpg", "res/textures/skybox/top.jpg", "res/textures/skybox/bottom.jpg", "res/textures/skybox/front.jpg", "res/textures/skybox/back.jpg"};
-    unsigned int cubemapTexture = loadCubemap(faces);
-
-    glUseProgram(cubeProg);
-    glUniform1i(glGetUniformLocation(cubeProg, "texture1"), 0);
-    glUniform1i(glGetUniformLocation(cubeProg, "normalMap"), 1);
-    glUniform1i(glGetUniformLocation(cubeProg, "skybox"), 2);
-    glUseProgram(skyProg); glUniform1i(glGetUniformLocation(skyProg, "skybox"), 0);
-    glUseProgram(screenProg); glUniform1i(glGetUniformLocation(screenProg, "screenTexture"), 0);
+    if(low_latency) {
+        glfwSwapInterval(1);
+        const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        if(mode && mode->refreshRate > 0) refresh_period = 1.0/mode->refreshRate;
+    }
+    init_scene();
+    if(wall_bench) { glfwSwapInterval(0); wall_benchmark(0); glfwTerminate(); return 0; }
+    if(replaying && replay_fast) glfwSwapInterval(0);
+    publish_snapshot(); shown = sim_latest(&snapshots);
+    // Late input sampling needs the step between the poll and the render, so --low-latency keeps it inline.
+    if(wall_count==0 && !low_latency) sim_threaded = sim_thread_start(sim_tick, 60.0) == 0;
+    if(capture_path) {
+        int cw = SCR_WIDTH, ch = SCR_HEIGHT;
+        if(!capture_scene) glfwGetFramebufferSize(window, &cw, &ch);
+        capture_start(capture_path, capture_format_for(capture_path), cw, ch, capture_fps);
+    }
 
+    double last_present = glfwGetTime(); int first_frame = 1;
     while (!glfwWindowShouldClose(window)) {
-        if(!animating) {
-            if(shuffling) { if(shuffle_moves>0) { trigger("xyz"[rand()%3], rand()%3-1, (rand()%2)*2-1, 1); shuffle_moves--; animation_speed=20; } else { shuffling=0; animation_speed=9; game_state=2; start_time=glfwGetTime(); } }
-            else if(solving && history_count>0) { Move m = history[--history_count]; trigger(m.axis, m.layer, -m.dir, 0); animation_speed=20; }
-            else { solving=0; if(game_state==2 && history_count==0) { game_state=0; final_time = glfwGetTime()-start_time; } }
+        double frame_start = glfwGetTime();
+        audio_begin_frame();
+        if(low_latency) {
+            double deadline = last_present + refresh_period;
+            while(deadline < frame_start) deadline += refresh_period;
+            wait_until(deadline - frame_cost - 0.0015);
+            frame_start = glfwGetTime();
+            glfwPollEvents();
         }
-        if(animating) { anim_angle+=animation_speed; if(anim_angle>=90) { rotate_layer_fixed(anim_axis, anim_layer, glm_rad(90*anim_dir)); animating=0; } }
-
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-        glEnable(GL_DEPTH_TEST);
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        mat4 view, proj; glm_mat4_identity(view); glm_mat4_identity(proj);
-        mat4 camRot; glm_mat4_identity(camRot);
-        glm_rotate(camRot, glm_rad(cube_pitch), (vec3){1,0,0}); glm_rotate(camRot, glm_rad(cube_yaw), (vec3){0,1,0});
-        vec4 rCamPos; glm_mat4_mulv(camRot, (vec4){0,0,cam_dist,1}, rCamPos);
-        glm_lookat((vec3){rCamPos[0],rCamPos[1],rCamPos[2]}, (vec3){0,0,0}, (vec3){0,1,0}, view);
-        glm_perspective(glm_rad(45.0f), (float)SCR_WIDTH/SCR_HEIGHT, 0.1f, 100.0f, proj);
-
-        glUseProgram(cubeProg);
-        glUniformMatrix4fv(glGetUniformLocation(cubeProg, "view"), 1, GL_FALSE, (float*)view);
-        glUniformMatrix4fv(glGetUniformLocation(cubeProg, "projection"), 1, GL_FALSE, (float*)proj);
-
-        float timeVal = (float)glfwGetTime();
-        float lightRadius = 15.0f;
-        float lightX = sin(timeVal) * lightRadius;
-        float lightZ = cos(timeVal) * lightRadius;
-        float lightY = 10.0f;
-
-        glUniform3f(glGetUniformLocation(cubeProg, "lightPos"), lightX, lightY, lightZ);        glUniform3f(glGetUniformLocation(cubeProg, "viewPos"), rCamPos[0], rCamPos[1], rCamPos[2]);
-
-        glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, cubeTexture);
-        glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, normalMap);
-        glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glBindVertexArray(cubeVAO);
-
-        for(int x=0; x<3; x++) for(int y=0; y<3; y++) for(int z=0; z<3; z++) {
-            mat4 model; glm_mat4_copy(cubie_mats[x][y][z], model);
-            if(animating) {
-                vec4 p={0,0,0,1}; glm_mat4_mulv(model, p, p);
-                int in=0; float eps=0.1f;
-                if(anim_axis=='x' && fabsf(p[0]-anim_layer)<eps) in=1;
-                if(anim_axis=='y' && fabsf(p[1]-anim_layer)<eps) in=1;
-                if(anim_axis=='z' && fabsf(p[2]-anim_layer)<eps) in=1;
-                if(in) {
-                    mat4 ar; glm_mat4_identity(ar); vec3 ax={0};
-                    if(anim_axis=='x') ax[0]=1; if(anim_axis=='y') ax[1]=1; if(anim_axis=='z') ax[2]=1;
-                    glm_rotate(ar, glm_rad(anim_angle*anim_dir), ax);
-                    mat4 t; glm_mat4_mul(ar, model, t); glm_mat4_copy(t, model);
-                }
-            }
-            glm_scale(model, (vec3){0.95f, 0.95f, 0.95f});
-            glUniformMatrix4fv(glGetUniformLocation(cubeProg, "model"), 1, GL_FALSE, (float*)model);
-            for(int f=0; f<6; f++) {
-                glVertexAttrib3fv(3, cubies[x][y][z].colors[f]);
-                glDrawArrays(GL_TRIANGLES, f*6, 6);
-            }
+        advance_frame();
+        double update_done = glfwGetTime();
+        render_scene(0, (float)(fixed_step ? shown->time : app_time()));
+        if(capture_scene && !software) capture_frame(scene_framebuffer(), SCR_WIDTH, SCR_HEIGHT);
+        else capture_frame(0, fb_width, fb_height);
+
+        double submit = glfwGetTime() - frame_start;
+        log_timing(update_done - frame_start, submit - (update_done - frame_start), submit);
+        glfwSwapBuffers(window);
+        if(finish_frames) glFinish();
+        record_frame_time(glfwGetTime() - last_present);
+        last_present = glfwGetTime();
+        if(first_frame) {
+            first_frame = 0; printf("Prvi frejm: %.1f ms\n", last_present*1000.0);
+            if(!no_audio) audio_start_async("res/sounds/move.wav");
         }
-
-        glDepthFunc(GL_LEQUAL); glUseProgram(skyProg);
-        mat4 viewNoTrans; glm_mat4_copy(view, viewNoTrans); viewNoTrans[3][0]=0; viewNoTrans[3][1]=0; viewNoTrans[3][2]=0;
-        glUniformMatrix4fv(glGetUniformLocation(skyProg, "view"), 1, GL_FALSE, (float*)viewNoTrans);
-        glUniformMatrix4fv(glGetUniformLocation(skyProg, "projection"), 1, GL_FALSE, (float*)proj);
-        glBindVertexArray(skyVAO); glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36); glDepthFunc(GL_LESS);
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDisable(GL_DEPTH_TEST);
-        glClearColor(1,1,1,1); glClear(GL_COLOR_BUFFER_BIT);
-        glUseProgram(screenProg);
-        glBindVertexArray(quadVAO);
-        glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, texColorBuffer);
-        glUniform1i(glGetUniformLocation(screenProg, "effectType"), postProcessEffect);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-
-        glfwSwapBuffers(window); glfwPollEvents();
+        frame_cost = frame_cost*0.9 + submit*0.1;
+        if(input_time >= 0 && (int)(shown->inputs - input_seq) >= 0) {
+            double lat = last_present - input_time; input_time = -1.0;
+            latency_sum += lat; latency_frames++; if(lat > latency_max) latency_max = lat;
+            if(latency_report) printf("input->present: %.2f ms (cpu %.2f ms)\n", lat*1000.0, submit*1000.0);
+        }
+        if(!low_latency) glfwPollEvents();
     }
-    ma_engine_uninit(&audio_engine); glfwTerminate(); return 0;
+    sim_thread_stop(); control_close(); shm_state_close();
+    scene_shutdown(); sim_buffer_free(&snapshots);
+    if(latency_report && latency_frames) printf("Latencija: prosek %.2f ms, max %.2f ms (%d frejmova)\n", latency_sum/latency_frames*1000.0, latency_max*1000.0, latency_frames);
+    capture_stop();
+    session_close(&session);
+    if(timings_file) fclose(timings_file);
+    audio_shutdown(); glfwTerminate(); return 0;
 }
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "movelog.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const unsigned char session_magic[8] = {'R','B','K','S','E','S',3,0};
+
+MoveCode move_encode(char axis, int layer, float dir) {
+    return (MoveCode)((axis-'x') | (layer&3)<<2 | (dir>0)<<4 | (fabsf(dir)>1.5f ? MOVE_HALF : 0) | (layer>>2)<<8);
+}
+
+int move_layer(MoveCode m) { return ((m>>2)&3) | (m>>8)<<2; }
+
+void move_decode(MoveCode m, char* axis, int* layer, float* dir) {
+    *axis = 'x' + (m&3); *layer = move_layer(m); *dir = ((m&0x10) ? 1.0f : -1.0f) * ((m&MOVE_HALF) ? 2.0f : 1.0f);
+}
+
+MoveCode move_inverse(MoveCode m) { return m ^ 0x10; }
+
+void movelog_init(MoveLog* log) { memset(log, 0, sizeof(*log)); }
+
+void movelog_free(MoveLog* log) {
+    for(int i=0; i<log->chunk_count; i++) free(log->chunks[i]);
+    free(log->chunks); movelog_init(log);
+}
+
+void movelog_clear(MoveLog* log) { log->count = 0; }
+
+int movelog_push(MoveLog* log, MoveCode m) {
+    size_t c = log->count / MOVELOG_CHUNK;
+    if(c == (size_t)log->chunk_count) {
+        if(log->chunk_count == log->chunk_cap) {
+            int cap = log->chunk_cap ? log->chunk_cap*2 : 4;
+            MoveCode** t = realloc(log->chunks, sizeof(MoveCode*)*cap);
+            if(!t) return -1;
+            log->chunks = t; log->chunk_cap = cap;
+        }
+        if(!(log->chunks[log->chunk_count] = malloc(MOVELOG_CHUNK*sizeof(MoveCode)))) return -1;
+        log->chunk_count++;
+    }
+    log->chunks[c][log->count % MOVELOG_CHUNK] = m;
+    log->count++;
+    return 0;
+}
+
+MoveCode movelog_pop(MoveLog* log) { log->count--; return movelog_get(log, log->count); }
+
+MoveCode movelog_get(const MoveLog* log, size_t i) { return log->chunks[i / MOVELOG_CHUNK][i % MOVELOG_CHUNK]; }
+
+static void movelog_set(MoveLog* log, size_t i, MoveCode m) { log->chunks[i / MOVELOG_CHUNK][i % MOVELOG_CHUNK] = m; }
+
+// Net quarter turns of a move, 0-3 (clockwise positive).
+static int move_quarters(MoveCode m) { return (m & MOVE_HALF) ? 2 : (m & 0x10) ? 1 : 3; }
+
+static MoveCode move_from_quarters(MoveCode m, int q) {
+    m &= 0xFF0F;
+    return q == 1 ? m | 0x10 : q == 2 ? m | 0x10 | MOVE_HALF : m;
+}
+
+int movelog_push_compact(MoveLog* log, MoveCode m) {
+    // Moves on one axis commute, so the trailing same-axis run is kept as at most one
+    // entry per layer, sorted by layer; a new move on that axis folds into it.
+    size_t start = log->count;
+    while(start > 0 && (movelog_get(log, start-1) & 3) == (m & 3)) start--;
+    size_t at = start;
+    for(size_t i = start; i < log->count; i++) {
+        MoveCode e = movelog_get(log, i);
+        if(move_layer(e) == move_layer(m)) {
+            int q = (move_quarters(e) + move_quarters(m)) & 3;
+            if(q) { movelog_set(log, i, move_from_quarters(e, q)); return 0; }
+            for(; i+1 < log->count; i++) movelog_set(log, i, movelog_get(log, i+1));
+            log->count--; return 0;
+        }
+        if(move_layer(e) < move_layer(m)) at = i+1;
+    }
+    if(movelog_push(log, m) != 0) return -1;
+    for(size_t i = log->count-1; i > at; i--) movelog_set(log, i, movelog_get(log, i-1));
+    movelog_set(log, at, move_from_quarters(m, move_quarters(m)));
+    return 0;
+}
+
+static int put_uleb(unsigned char* buf, unsigned long long v) {
+    int n = 0;
+    do { unsigned char b = v & 0x7F; v >>= 7; buf[n++] = b | (v ? 0x80 : 0); } while(v);
+    return n;
+}
+
+// Fails on a value cut off by the end of the data or longer than 64 bits.
+static int get_uleb(SessionReader* r, unsigned long long* v) {
+    *v = 0;
+    for(int shift = 0; r->pos < r->size && shift < 64; shift += 7) {
+        unsigned char b = r->data[r->pos++];
+        *v |= (unsigned long long)(b & 0x7F) << shift;
+        if(!(b & 0x80)) return 0;
+    }
+    return -1;
+}
+
+// Reports a damaged record and ends the replay there.
+static int corrupt(SessionReader* r) { printf("GRESKA: ostecen snimak sesije (bajt %zu)\n", r->pos); r->pos = r->size; return 0; }
+
+static int payload_size(unsigned char code) {
+    if(code < 0x80) return 0;
+    if(code == SESSION_CAMERA) return 8;
+    if(code == SESSION_KEY) return 2;
+    if(code == SESSION_SEED) return 4;
+    if(code == SESSION_SETTINGS) return 8;
+    if(code == SESSION_WIDE_MOVE || code == SESSION_SIZE || code == SESSION_REMOTE) return 2;
+    return -1;
+}
+
+int session_create(SessionWriter* w, const char* path) {
+    w->f = fopen(path, "wb"); w->last_ms = 0; w->frame = 0; w->records = 0;
+    if(!w->f) { printf("GRESKA: Nije moguce otvoriti fajl: %s\n", path); return -1; }
+    fwrite(session_magic, 1, sizeof(session_magic), w->f);
+    return 0;
+}
+
+void session_record(SessionWriter* w, unsigned char code, const void* payload, int len, long long frame, double t) {
+    if(!w->f) return;
+    unsigned char buf[32]; int n = 0;
+    if(frame > w->frame) { buf[n++] = SESSION_FRAME; n += put_uleb(buf+n, (unsigned long long)(frame - w->frame)); w->frame = frame; }
+    long long ms = (long long)(t*1000.0 + 0.5);
+    if(w->records == 0) w->last_ms = ms;
+    buf[n++] = code;
+    n += put_uleb(buf+n, ms > w->last_ms ? (unsigned long long)(ms - w->last_ms) : 0);
+    fwrite(buf, 1, n, w->f);
+    if(len > 0) fwrite(payload, 1, len, w->f);
+    if(ms > w->last_ms) w->last_ms = ms;
+    w->records++;
+}
+
+void session_move(SessionWriter* w, MoveCode m, long long frame, double t) {
+    unsigned char p[2] = { (unsigned char)(m & 0xFF), (unsigned char)(m >> 8) };
+    if(m < 0x80) session_record(w, (unsigned char)m, NULL, 0, frame, t);
+    else session_record(w, SESSION_WIDE_MOVE, p, 2, frame, t);
+}
+
+void session_close(SessionWriter* w) {
+    if(w->f) { fclose(w->f); w->f = NULL; }
+}
+
+int session_open(SessionReader* r, const char* path) {
+    memset(r, 0, sizeof(*r));
+#ifndef _WIN32
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED) { r->data = p; r->size = (size_t)st.st_size; r->mapped = 1; madvise(p, r->size, MADV_SEQUENTIAL); }
+    }
+    if(fd >= 0) close(fd);
+#endif
+    if(!r->data) {
+        FILE* f = fopen(path, "rb");
+        if(f) {
+            fseek(f, 0, SEEK_END); long len = ftell(f); fseek(f, 0, SEEK_SET);
+            unsigned char* buf = len > 0 ? malloc(len) : NULL;
+            if(buf && fread(buf, 1, len, f) == (size_t)len) { r->data = buf; r->size = (size_t)len; } else free(buf);
+            fclose(f);
+        }
+    }
+    if(!r->data) { printf("GRESKA: Nije moguce otvoriti fajl: %s\n", path); return -1; }
+    if(r->size < sizeof(session_magic) || memcmp(r->data, session_magic, 6) != 0) {
+        printf("GRESKA: %s nije snimak sesije\n", path); session_release(r); return -1;
+    }
+    if(r->data[6] != session_magic[6]) { printf("GRESKA: %s je snimak verzije %d, podrzana je %d\n", path, r->data[6], session_magic[6]); session_release(r); return -1; }
+    r->pos = sizeof(session_magic);
+    return 0;
+}
+
+int session_next(SessionReader* r, SessionRecord* rec) {
+    unsigned long long delta;
+    while(r->pos < r->size && r->data[r->pos] == SESSION_FRAME) { r->pos++; if(get_uleb(r, &delta) != 0) return corrupt(r); r->frame += (long long)delta; }
+    if(r->pos >= r->size) return 0;
+    unsigned char code = r->data[r->pos++];
+    if(get_uleb(r, &delta) != 0) return corrupt(r);
+    r->ms += (long long)delta;
+    int len = payload_size(code);
+    if(len < 0 || r->pos + len > r->size) return corrupt(r);
+    rec->code = code; rec->payload = r->data + r->pos; rec->frame = r->frame; rec->t = r->ms/1000.0;
+    rec->move = code < 0x80 ? code : code == SESSION_WIDE_MOVE ? (MoveCode)(rec->payload[0] | rec->payload[1]<<8) : MOVE_NONE;
+    r->pos += len;
+    return 1;
+}
+
+void session_release(SessionReader* r) {
+    if(!r->data) return;
+#ifndef _WIN32
+    if(r->mapped) munmap((void*)r->data, r->size); else
+#endif
+    free((void*)r->data);
+    memset(r, 0, sizeof(*r));
+}
@@ -0,0 +1,62 @@
+#ifndef MOVELOG_H
+#define MOVELOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Move code: bits 0-1 axis (x,y,z), bits 2-3 low bits of the layer index (0..n-1), bit 4 dir>0,
+// bit 5 half turn (dir is then +-2), bits 8-15 the rest of the layer index. Moves on cubes up
+// to 4x4x4 fit in the low byte, which is what a session file stores; byte values >= 0x80 are
+// reserved there for non-move records.
+typedef unsigned short MoveCode;
+#define MOVE_HALF 0x20
+#define MOVE_NONE 0xFFFF
+#define MOVELOG_CHUNK 4096
+
+MoveCode move_encode(char axis, int layer, float dir);
+void move_decode(MoveCode m, char* axis, int* layer, float* dir);
+MoveCode move_inverse(MoveCode m);
+int move_layer(MoveCode m);
+
+// Growable history in fixed-size chunks; only the chunk pointer table is ever reallocated.
+typedef struct { MoveCode** chunks; size_t count; int chunk_count, chunk_cap; } MoveLog;
+
+void movelog_init(MoveLog* log);
+void movelog_free(MoveLog* log);
+void movelog_clear(MoveLog* log);
+int movelog_push(MoveLog* log, MoveCode m);
+MoveCode movelog_pop(MoveLog* log);
+MoveCode movelog_get(const MoveLog* log, size_t i);
+// Push with on-the-fly compaction: X X' cancels, X X becomes a half turn, four quarter turns
+// vanish, and commuting moves on the same axis are kept in layer order. The log then holds
+// the net move sequence, so a rewind is never longer than the real distance to its start.
+int movelog_push_compact(MoveLog* log, MoveCode m);
+
+// Session file: 8-byte header, then records [code][ULEB128 ms since previous record][payload].
+// Codes below 0x80 are moves (no payload); SESSION_WIDE_MOVE carries a 2-byte move code for
+// layers beyond the low byte, SESSION_SIZE the cube size (2 bytes), SESSION_REMOTE a move
+// received over the control socket (2 bytes; replayed as input, followed by its move record),
+// SESSION_SETTINGS the auto shuffle length (4 bytes) and turbo budget (float, 4 bytes), which
+// steer how the cube evolves and so are restored by a replay. A SESSION_FRAME marker ([code][ULEB128 frame delta],
+// no timestamp) precedes the records of each simulation frame that has any, so a replay can
+// apply every input on exactly the frame it was recorded on.
+enum { SESSION_CAMERA = 0x80, SESSION_KEY = 0x81, SESSION_SEED = 0x82, SESSION_FRAME = 0x83, SESSION_WIDE_MOVE = 0x84, SESSION_SIZE = 0x85, SESSION_REMOTE = 0x86,
+       SESSION_SETTINGS = 0x87 };
+
+typedef struct { FILE* f; long long last_ms, frame; size_t records; } SessionWriter;
+
+int session_create(SessionWriter* w, const char* path);
+void session_record(SessionWriter* w, unsigned char code, const void* payload, int len, long long frame, double t);
+void session_move(SessionWriter* w, MoveCode m, long long frame, double t);
+void session_close(SessionWriter* w);
+
+// Replay side maps the whole file read-only and walks it in place.
+typedef struct { const unsigned char* data; size_t size, pos; long long ms, frame; int mapped; } SessionReader;
+// move is set for both move record forms, MOVE_NONE otherwise.
+typedef struct { unsigned char code; const unsigned char* payload; MoveCode move; long long frame; double t; } SessionRecord;
+
+int session_open(SessionReader* r, const char* path);
+int session_next(SessionReader* r, SessionRecord* rec);
+void session_release(SessionReader* r);
+
+#endif
@@ -0,0 +1,165 @@
+#include "render.h"
+
+#include <string.h>
+
+#include <glad/glad.h>
+
+RenderStats rc_stats;
+static const RenderBackend* backend = &rc_gl;
+
+static const GLenum tex_targets[] = { GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BUFFER };
+static const GLenum buf_targets[] = { GL_ARRAY_BUFFER, GL_TEXTURE_BUFFER };
+static const GLenum depth_funcs[] = { GL_LESS, GL_LEQUAL };
+static const int uniform_floats[] = { 1, 1, 2, 3, 9, 16 };
+
+// --- GL 3.3 ---
+
+// What rc_gl last set, so calls that would change nothing are dropped. All zero is GL's initial
+// state and ~0u is unknown (after rc_invalidate); the active unit only moves when a binding on
+// another unit has to change.
+// Framebuffers are bound for drawing only, which leaves the read binding to capture/readback.
+#define SHADOW_UNITS 16
+#define UPLOAD_UNIT (SHADOW_UNITS-1)
+static struct {
+    unsigned int fbo, prog, vao, unit, buffers[2], textures[SHADOW_UNITS][3];
+    unsigned int depth_test, depth_func, blend;
+} shadow;
+RenderStateStats rc_state_stats;
+
+static int changed(unsigned int* slot, unsigned int value) {
+    if(*slot == value) { rc_state_stats.skipped++; return 0; }
+    *slot = value; rc_state_stats.issued++;
+    return 1;
+}
+
+void rc_invalidate() { memset(&shadow, 0xFF, sizeof(shadow)); }
+
+static void gl_target(unsigned int fbo) { if(changed(&shadow.fbo, fbo)) glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo); }
+
+static void gl_clear(float r, float g, float b, int depth) {
+    glClearColor(r, g, b, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | (depth ? GL_DEPTH_BUFFER_BIT : 0));
+}
+
+static void gl_program(unsigned int prog) { if(changed(&shadow.prog, prog)) glUseProgram(prog); }
+static int gl_location(unsigned int prog, const char* name) { return glGetUniformLocation(prog, name); }
+
+static void gl_uniform(int loc, int type, int count, const void* v) {
+    switch(type) {
+    case RC_INT: glUniform1iv(loc, count, (const GLint*)v); break;
+    case RC_FLOAT: glUniform1fv(loc, count, (const float*)v); break;
+    case RC_VEC2: glUniform2fv(loc, count, (const float*)v); break;
+    case RC_VEC3: glUniform3fv(loc, count, (const float*)v); break;
+    case RC_MAT3: glUniformMatrix3fv(loc, count, GL_FALSE, (const float*)v); break;
+    case RC_MAT4: glUniformMatrix4fv(loc, count, GL_FALSE, (const float*)v); break;
+    }
+}
+
+static void gl_active(unsigned int unit) { if(changed(&shadow.unit, unit)) glActiveTexture(GL_TEXTURE0 + unit); }
+
+static void gl_texture(int unit, int target, unsigned int tex) {
+    if(!changed(&shadow.textures[unit][target], tex)) return;
+    gl_active(unit); glBindTexture(tex_targets[target], tex);
+}
+
+static void gl_vertex_array(unsigned int vao) { if(changed(&shadow.vao, vao)) glBindVertexArray(vao); }
+
+static void gl_depth(int test, int func) {
+    if(changed(&shadow.depth_test, test)) { if(test) glEnable(GL_DEPTH_TEST); else glDisable(GL_DEPTH_TEST); }
+    if(changed(&shadow.depth_func, func)) glDepthFunc(depth_funcs[func]);
+}
+
+static void gl_blend(int enable) {
+    if(!changed(&shadow.blend, enable)) return;
+    if(enable) { glEnable(GL_BLEND); glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); }
+    else glDisable(GL_BLEND);
+}
+
+static void gl_attrib(int index, const float* xyz) { glVertexAttrib3fv(index, xyz); }
+
+// A store allocated empty is updated in ranges later (dynamic); one allocated with its data is
+// refilled whole every frame (stream, the old store is orphaned).
+static void gl_buffer(int target, unsigned int buf, long offset, size_t size, const void* data) {
+    GLenum t = buf_targets[target];
+    if(changed(&shadow.buffers[target], buf)) glBindBuffer(t, buf);
+    if(offset < 0) glBufferData(t, (GLsizeiptr)size, data, data ? GL_STREAM_DRAW : GL_DYNAMIC_DRAW);
+    else glBufferSubData(t, (GLintptr)offset, (GLsizeiptr)size, data);
+}
+
+// Uploads bind on the last unit, which no program samples, so they never disturb the bindings
+// the draws rely on.
+static void gl_image(unsigned int tex, int format, int width, int height, const void* data, int resize) {
+    static const GLenum internals[] = { GL_R8UI, GL_RGBA8, GL_R32F }, formats[] = { GL_RED_INTEGER, GL_RGBA, GL_RED }, types[] = { GL_UNSIGNED_BYTE, GL_UNSIGNED_BYTE, GL_FLOAT };
+    GLenum internal = internals[format], fmt = formats[format], type = types[format];
+    gl_active(UPLOAD_UNIT);
+    if(changed(&shadow.textures[UPLOAD_UNIT][RC_TEX_2D], tex)) glBindTexture(GL_TEXTURE_2D, tex);
+    if(format == RC_R8UI) glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if(resize) glTexImage2D(GL_TEXTURE_2D, 0, internal, width, height, 0, fmt, type, data);
+    else glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, fmt, type, data);
+    if(format == RC_R8UI) glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+static void gl_draw(int first, int count, int instances) {
+    if(instances) glDrawArraysInstanced(GL_TRIANGLES, first, count, instances);
+    else glDrawArrays(GL_TRIANGLES, first, count);
+}
+
+static void gl_blit(unsigned int src, int src_w, int src_h, unsigned int dst, int dst_w, int dst_h) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, src); rc_state_stats.issued++;
+    gl_target(dst);
+    glBlitFramebuffer(0, 0, src_w, src_h, 0, 0, dst_w, dst_h, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+}
+
+const RenderBackend rc_gl = { gl_target, gl_clear, gl_program, gl_location, gl_uniform, gl_texture, gl_vertex_array,
+                              gl_depth, gl_blend, gl_attrib, gl_buffer, gl_image, gl_draw, gl_blit };
+
+// --- null: counts only ---
+
+static void count(int command, size_t bytes) { rc_stats.commands[command]++; rc_stats.bytes += bytes; }
+
+static void null_target(unsigned int fbo) { (void)fbo; count(RC_TARGET, 0); }
+static void null_clear(float r, float g, float b, int depth) { (void)r; (void)g; (void)b; (void)depth; count(RC_CLEAR, 0); }
+static void null_program(unsigned int prog) { (void)prog; count(RC_PROGRAM, 0); }
+static int null_location(unsigned int prog, const char* name) { (void)prog; (void)name; return -1; }
+static void null_uniform(int loc, int type, int n, const void* v) { (void)loc; (void)v; count(RC_UNIFORM, sizeof(float)*uniform_floats[type]*(size_t)n); }
+static void null_texture(int unit, int target, unsigned int tex) { (void)unit; (void)target; (void)tex; count(RC_TEXTURE, 0); }
+static void null_vertex_array(unsigned int vao) { (void)vao; count(RC_VERTEX_ARRAY, 0); }
+static void null_depth(int test, int func) { (void)test; (void)func; count(RC_DEPTH, 0); }
+static void null_blend(int enable) { (void)enable; count(RC_BLEND, 0); }
+static void null_attrib(int index, const float* xyz) { (void)index; (void)xyz; count(RC_ATTRIB, 3*sizeof(float)); }
+static void null_buffer(int target, unsigned int buf, long offset, size_t size, const void* data) { (void)target; (void)buf; (void)offset; count(RC_BUFFER, data ? size : 0); }
+static void null_image(unsigned int tex, int format, int w, int h, const void* data, int resize) {
+    (void)tex; (void)resize;
+    count(RC_IMAGE, data ? (size_t)w*h*(format == RC_R8UI ? 1 : 4) : 0);  // RGBA8 and R32F are both 4 bytes
+}
+static void null_draw(int first, int n, int instances) { (void)first; (void)n; (void)instances; count(RC_DRAW, 0); }
+static void null_blit(unsigned int src, int sw, int sh, unsigned int dst, int dw, int dh) { (void)src; (void)sw; (void)sh; (void)dst; (void)dw; (void)dh; count(RC_BLIT, 0); }
+
+const RenderBackend rc_null = { null_target, null_clear, null_program, null_location, null_uniform, null_texture, null_vertex_array,
+                                null_depth, null_blend, null_attrib, null_buffer, null_image, null_draw, null_blit };
+
+void rc_use(const RenderBackend* b) { backend = b; rc_invalidate(); }
+int rc_is_null() { return backend == &rc_null; }
+
+const char* rc_command_name(int command) {
+    static const char* names[RC_COMMANDS] = { "target", "clear", "program", "uniform", "texture", "vertex_array", "depth",
+                                              "blend", "attrib", "buffer", "image", "draw", "blit" };
+    return command >= 0 && command < RC_COMMANDS ? names[command] : "?";
+}
+
+void rc_target(unsigned int fbo) { backend->target(fbo); }
+void rc_clear(float r, float g, float b, int depth) { backend->clear(r, g, b, depth); }
+void rc_program(unsigned int prog) { backend->program(prog); }
+int rc_location(unsigned int prog, const char* name) { return backend->location(prog, name); }
+void rc_uniform(int loc, int type, int n, const void* value) { backend->uniform(loc, type, n, value); }
+void rc_uniform1i(int loc, int v) { backend->uniform(loc, RC_INT, 1, &v); }
+void rc_uniform1f(int loc, float v) { backend->uniform(loc, RC_FLOAT, 1, &v); }
+void rc_texture(int unit, int target, unsigned int tex) { backend->texture(unit, target, tex); }
+void rc_vertex_array(unsigned int vao) { backend->vertex_array(vao); }
+void rc_depth(int test, int func) { backend->depth(test, func); }
+void rc_blend(int enable) { backend->blend(enable); }
+void rc_attrib(int index, const float* xyz) { backend->attrib(index, xyz); }
+void rc_buffer(int target, unsigned int buf, long offset, size_t size, const void* data) { backend->buffer(target, buf, offset, size, data); }
+void rc_image(unsigned int tex, int format, int w, int h, const void* data, int resize) { backend->image(tex, format, w, h, data, resize); }
+void rc_draw(int first, int n, int instances) { backend->draw(first, n, instances); }
+void rc_blit(unsigned int src, int sw, int sh, unsigned int dst, int dw, int dh) { backend->blit(src, sw, sh, dst, dw, dh); }
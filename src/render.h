@@ -0,0 +1,84 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include <stddef.h>
+
+// Render commands for the per-frame passes (scene.c, facelet.c, hud.c). They cover the few
+// GL 3.3 operations those passes use and go to the selected backend:
+//   rc_gl   - issues the GL calls (the default)
+//   rc_null - issues nothing and only counts the commands and the bytes they carry, so the
+//             simulation and frame building can be timed with no driver underneath.
+// Handles are GL object names (0 is the default framebuffer). Resources are created with GL
+// directly at startup; with the null backend that step is skipped and all handles stay 0.
+
+enum { RC_TARGET, RC_CLEAR, RC_PROGRAM, RC_UNIFORM, RC_TEXTURE, RC_VERTEX_ARRAY, RC_DEPTH, RC_BLEND,
+       RC_ATTRIB, RC_BUFFER, RC_IMAGE, RC_DRAW, RC_BLIT, RC_COMMANDS };
+enum { RC_INT, RC_FLOAT, RC_VEC2, RC_VEC3, RC_MAT3, RC_MAT4 };   // uniform types
+enum { RC_TEX_2D, RC_TEX_CUBE, RC_TEX_BUFFER };                   // texture targets
+enum { RC_ARRAY_BUFFER, RC_TEXTURE_BUFFER };                      // buffer targets
+enum { RC_R8UI, RC_RGBA8, RC_R32F };                              // image formats
+enum { RC_LESS, RC_LEQUAL };                                      // depth functions
+
+typedef struct {
+    void (*target)(unsigned int fbo);
+    void (*clear)(float r, float g, float b, int depth);
+    void (*program)(unsigned int prog);
+    int  (*location)(unsigned int prog, const char* name);
+    void (*uniform)(int loc, int type, int count, const void* value);
+    void (*texture)(int unit, int target, unsigned int tex);
+    void (*vertex_array)(unsigned int vao);
+    void (*depth)(int test, int func);
+    void (*blend)(int enable);
+    void (*attrib)(int index, const float* xyz);
+    void (*buffer)(int target, unsigned int buf, long offset, size_t size, const void* data);
+    void (*image)(unsigned int tex, int format, int width, int height, const void* data, int resize);
+    void (*draw)(int first, int count, int instances);
+    void (*blit)(unsigned int src, int src_w, int src_h, unsigned int dst, int dst_w, int dst_h);
+} RenderBackend;
+
+typedef struct { unsigned long long commands[RC_COMMANDS], bytes; } RenderStats;
+// rc_gl shadows the state its commands set (framebuffer, program, vertex array, active unit and
+// texture bindings, buffer bindings, depth test/func, blend) and drops changes that are
+// already in effect: issued reached GL, skipped did not.
+typedef struct { unsigned long long issued, skipped; } RenderStateStats;
+
+extern const RenderBackend rc_gl, rc_null;
+extern RenderStats rc_stats;  // filled by rc_null
+extern RenderStateStats rc_state_stats;  // filled by rc_gl
+
+void rc_use(const RenderBackend* backend);
+int rc_is_null(void);
+const char* rc_command_name(int command);
+// Forgets the shadowed state; call after binding or enabling anything with GL directly.
+void rc_invalidate(void);
+
+// The framebuffer to draw into (0 = default); the read binding is left alone.
+void rc_target(unsigned int fbo);
+// Clears colour, and depth too when depth is set.
+void rc_clear(float r, float g, float b, int depth);
+void rc_program(unsigned int prog);
+// Uniform location in prog, resolved once at init; -1 with the null backend.
+int rc_location(unsigned int prog, const char* name);
+// count values of type at loc in the current program (matrices column-major).
+void rc_uniform(int loc, int type, int count, const void* value);
+void rc_uniform1i(int loc, int v);
+void rc_uniform1f(int loc, float v);
+void rc_texture(int unit, int target, unsigned int tex);
+void rc_vertex_array(unsigned int vao);
+void rc_depth(int test, int func);
+// Straight alpha blending (SRC_ALPHA, ONE_MINUS_SRC_ALPHA) on or off.
+void rc_blend(int enable);
+// Constant value of a vertex attribute with no array behind it.
+void rc_attrib(int index, const float* xyz);
+// offset < 0 (re)allocates the store with size bytes, filled from data when it is not NULL;
+// otherwise size bytes at offset are replaced.
+void rc_buffer(int target, unsigned int buf, long offset, size_t size, const void* data);
+// Whole-image upload into a 2D texture; resize re-specifies the storage at the new size. The
+// texture bindings used for drawing are not affected.
+void rc_image(unsigned int tex, int format, int width, int height, const void* data, int resize);
+// Triangles; instances 0 is a plain draw.
+void rc_draw(int first, int count, int instances);
+// Scaled colour copy from src to dst, linear filtered; dst stays bound.
+void rc_blit(unsigned int src, int src_w, int src_h, unsigned int dst, int dst_w, int dst_h);
+
+#endif
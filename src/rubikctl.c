@@ -0,0 +1,165 @@
+// rubikctl: command-line client for the control socket (see control.h). Prints the cube
+// state, then measures ping round-trip latency and sustained move throughput.
+//   rubikctl [--socket PATH] [--pings N] [--moves N] [--batch N] [--window N]
+// With --shm it instead samples the shared-memory state (see shmstate.h) for a second.
+//   rubikctl --shm [NAME]
+
+#include "control.h"
+#include "shmstate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+static double now() { struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+
+static int send_all(int fd, const void* buf, size_t len) {
+    const unsigned char* p = buf;
+    while(len > 0) { ssize_t w = send(fd, p, len, 0); if(w <= 0) return -1; p += w; len -= (size_t)w; }
+    return 0;
+}
+
+static int recv_all(int fd, void* buf, size_t len) {
+    unsigned char* p = buf;
+    while(len > 0) { ssize_t r = recv(fd, p, len, 0); if(r <= 0) return -1; p += r; len -= (size_t)r; }
+    return 0;
+}
+
+static unsigned int get32(const unsigned char* p) { return p[0] | p[1]<<8 | p[2]<<16 | (unsigned int)p[3]<<24; }
+
+static int cmp_double(const void* a, const void* b) { double x = *(const double*)a, y = *(const double*)b; return x < y ? -1 : x > y; }
+
+// Returns the cube size, or -1.
+static int query(int fd) {
+    unsigned char req[4] = { CONTROL_QUERY, 0, 0, 0 }, h[12];
+    if(send_all(fd, req, 4) || recv_all(fd, h, 12) || h[0] != CONTROL_STATE) return -1;
+    int n = h[2] | h[3]<<8; size_t size = 6*(size_t)n*n;
+    unsigned char* st = malloc(size);
+    if(!st || recv_all(fd, st, size)) { free(st); return -1; }
+    int solved = 1;
+    for(size_t i=0; i<size; i++) if(st[i] != st[i/((size_t)n*n)*n*n]) { solved = 0; break; }
+    unsigned int flags = get32(h+4);
+    printf("Kocka %dx%dx%d, istorija %u poteza, %s%s%s%s\n", n, n, n, get32(h+8), solved ? "slozena" : "promesana",
+        flags & CONTROL_BUSY_ANIMATING ? ", animacija" : "", flags & CONTROL_BUSY_SHUFFLING ? ", mesanje" : "", flags & CONTROL_BUSY_SOLVING ? ", resavanje" : "");
+    free(st);
+    return n;
+}
+
+static void ping(int fd, int count) {
+    if(count <= 0) return;
+    double* rtt = malloc(sizeof(double)*count);
+    if(!rtt) return;
+    for(int i=0; i<count; i++) {
+        unsigned char req[4] = { CONTROL_PING, 0, (unsigned char)i, (unsigned char)(i>>8) }, rep[4];
+        double t0 = now();
+        if(send_all(fd, req, 4) || recv_all(fd, rep, 4)) { printf("GRESKA: veza prekinuta\n"); free(rtt); return; }
+        rtt[i] = (now()-t0)*1e6;
+    }
+    qsort(rtt, count, sizeof(double), cmp_double);
+    double sum = 0; for(int i=0; i<count; i++) sum += rtt[i];
+    printf("Ping (%d): min %.1f us, prosek %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n",
+        count, rtt[0], sum/count, rtt[count/2], rtt[(int)(count*0.99)], rtt[count-1]);
+    free(rtt);
+}
+
+// Streams random moves in batches with up to `window` batches awaiting their ACK.
+static void throughput(int fd, int n, long moves, int batch, int window) {
+    if(moves <= 0 || n <= 0) return;
+    unsigned char* req = malloc(4 + 2*(size_t)batch);
+    if(!req) return;
+    long sent = 0, acked = 0, applied = 0; int outstanding = 0; unsigned int total = 0;
+    double t0 = now();
+    while(acked < moves) {
+        while(sent < moves && outstanding < window) {
+            int count = moves - sent < batch ? (int)(moves - sent) : batch;
+            req[0] = CONTROL_MOVES; req[1] = 0; req[2] = (unsigned char)count; req[3] = (unsigned char)(count>>8);
+            for(int i=0; i<count; i++) { MoveCode m = move_encode("xyz"[rand()%3], rand()%n, (rand()%2)*2-1); req[4+2*i] = (unsigned char)m; req[5+2*i] = (unsigned char)(m>>8); }
+            if(send_all(fd, req, 4 + 2*(size_t)count)) { printf("GRESKA: veza prekinuta\n"); free(req); return; }
+            sent += count; outstanding++;
+        }
+        unsigned char ack[8];
+        if(recv_all(fd, ack, 8) || ack[0] != CONTROL_ACK) { printf("GRESKA: neocekivan odgovor\n"); free(req); return; }
+        int count = moves - acked < batch ? (int)(moves - acked) : batch;
+        acked += count; applied += ack[2] | ack[3]<<8; total = get32(ack+4); outstanding--;
+    }
+    double dt = now()-t0;
+    printf("Potezi: %ld poslato, %ld primenjeno za %.3f s = %.0f poteza/s (paket %d, prozor %d, ukupno na serveru %u)\n",
+        moves, applied, dt, moves/dt, batch, window, total);
+    free(req);
+}
+
+// Maps the whole segment and sizes the copy buffer to match; called again when it has grown.
+static int map_segment(int fd, const SharedCubeState** src, size_t* mapped, SharedCubeState** copy) {
+    struct stat sb;
+    if(*src) { munmap((void*)*src, *mapped); *src = NULL; }
+    if(fstat(fd, &sb) != 0 || (size_t)sb.st_size < sizeof(SharedCubeState)) return -1;
+    void* p = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(p == MAP_FAILED) return -1;
+    *src = p; *mapped = (size_t)sb.st_size;
+    SharedCubeState* c = realloc(*copy, *mapped);
+    if(!c) return -1;
+    *copy = c;
+    return 0;
+}
+
+// Reads the segment as fast as possible for one second and reports the sampling rate.
+static int watch(const char* name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if(fd < 0) { printf("GRESKA: deljena memorija %s ne postoji\n", name); return 1; }
+    const SharedCubeState* src = NULL; SharedCubeState* st = NULL; size_t mapped = 0;
+    int ok = map_segment(fd, &src, &mapped, &st) == 0 && src->magic == SHM_STATE_MAGIC;
+    if(!ok) printf("GRESKA: nepoznat format deljene memorije\n");
+    long samples = 0, retries = 0, changes = 0; unsigned int last = 0;
+    double t0 = now();
+    while(ok && now() - t0 < 1.0) {
+        int r = shm_state_read(src, mapped, st, mapped);
+        if(r == -2) { printf("GRESKA: upis u deljenu memoriju se ne zavrsava (seq %u), pisac je verovatno zaglavljen ili ugasen\n", __atomic_load_n(&src->seq, __ATOMIC_RELAXED)); ok = 0; break; }
+        if(r < 0) { if(map_segment(fd, &src, &mapped, &st) != 0) { printf("GRESKA: deljena memorija nije ponovo mapirana\n"); ok = 0; } continue; }
+        retries += r; samples++;
+        if(st->seq != last) { changes++; last = st->seq; }
+    }
+    if(ok && samples) {
+        printf("Uzorci: %ld/s, promena %ld, ponovljenih citanja %ld\n", samples, changes, retries);
+        printf("Kocka %dx%dx%d, frejm %lld, stanje %d, potezi %u (ukupno %u), istorija %u, animacija %.0f%%, vreme %.2f s\n",
+            st->n, st->n, st->n, st->frame, st->game_state, st->total_moves, st->moves_done, st->history, st->anim_progress*100.0f,
+            st->game_state == 2 ? st->time - st->start_time : st->final_time);
+    }
+    if(src) munmap((void*)src, mapped);
+    free(st); close(fd);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    const char* path = CONTROL_DEFAULT_PATH; int pings = 1000, batch = 256, window = 8; long moves = 100000;
+    for(int i=1; i<argc; i++) {
+        if(!strcmp(argv[i], "--socket") && i+1<argc) path = argv[++i];
+        else if(!strcmp(argv[i], "--shm")) return watch(i+1<argc ? argv[i+1] : SHM_STATE_DEFAULT_NAME);
+        else if(!strcmp(argv[i], "--pings") && i+1<argc) pings = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--moves") && i+1<argc) moves = atol(argv[++i]);
+        else if(!strcmp(argv[i], "--batch") && i+1<argc) batch = atoi(argv[++i]);
+        else if(!strcmp(argv[i], "--window") && i+1<argc) window = atoi(argv[++i]);
+        else { printf("Nepoznata opcija: %s\n", argv[i]); return 1; }
+    }
+    if(batch < 1) batch = 1;
+    if(batch > CONTROL_MAX_BATCH) batch = CONTROL_MAX_BATCH;
+    if(window < 1) window = 1;
+    struct sockaddr_un addr; memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX; strncpy(addr.sun_path, path, sizeof(addr.sun_path)-1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) { printf("GRESKA: nije moguce povezati se na %s\n", path); return 1; }
+    srand((unsigned int)time(NULL));
+    int n = query(fd);
+    if(n < 0) { printf("GRESKA: upit nije uspeo\n"); close(fd); return 1; }
+    ping(fd, pings);
+    throughput(fd, n, moves, batch, window);
+    query(fd);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,342 @@
+#include "scene.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
+
+#include <glad/glad.h>
+#include "stb_image.h"
+
+#include "render.h"
+#include "cube.h"
+#include "wall.h"
+#include "hud.h"
+#include "facelet.h"
+#include "swr.h"
+
+static const char* skyboxVertSrc = "#version 330 core\nlayout (location=0) in vec3 aPos;\nout vec3 TexCoords;\nuniform mat4 projection;\nuniform mat4 view;\nvoid main(){\nTexCoords=aPos;\ngl_Position=(projection*view*vec4(aPos,1.0)).xyww;\n}\0";
+static const char* skyboxFragSrc = "#version 330 core\nout vec4 FragColor;\nin vec3 TexCoords;\nuniform samplerCube skybox;\nvoid main(){\nFragColor=texture(skybox,TexCoords);\n}\n\0";
+
+static unsigned int cubeProg, faceletProg, screenProg, skyProg, hudProg, cubeVAO, quadVAO, skyVAO, fbo, texColorBuffer;
+static unsigned int cubeTexture, normalMap, cubemapTexture;
+static unsigned int wallVAO, instanceVBO, animTBO, animTexture;
+static CubieInstance* wall_instances = NULL; static WallAnim* wall_anim = NULL; static int wall_capacity = 0;
+static unsigned int swTexture, swFbo; static int sw_active = 0;
+static int scene_w, scene_h;
+
+// Per-frame uniforms, resolved once: [0] faceletProg, [1] cubeProg.
+static int view_loc[2], proj_loc[2], light_loc[2], eye_loc[2];
+static int sky_view_loc, sky_proj_loc, effect_loc, instanced_loc;
+
+static const char* diffuse_path = "res/textures/container.jpg";
+static const char* normal_path = "res/textures/normal_map.png";
+static char* sky_faces[] = {"res/textures/skybox/right.jpg", "res/textures/skybox/left.jpg", "res/textures/skybox/top.jpg", "res/textures/skybox/bottom.jpg", "res/textures/skybox/front.jpg", "res/textures/skybox/back.jpg"};
+
+static char* readFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) { printf("GRESKA: Nije moguce otvoriti fajl: %s\n", path); return NULL; }
+    fseek(file, 0, SEEK_END); long length = ftell(file); fseek(file, 0, SEEK_SET);
+    char* buffer = malloc(length + 1); fread(buffer, 1, length, file);
+    buffer[length] = '\0'; fclose(file); return buffer;
+}
+
+static unsigned int createShader(const char* source, GLenum type) {
+    unsigned int shader = glCreateShader(type); glShaderSource(shader, 1, &source, NULL); glCompileShader(shader);
+    int success; char infoLog[512]; glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) { glGetShaderInfoLog(shader, 512, NULL, infoLog); printf("Shader Error: %s\n", infoLog); }
+    return shader;
+}
+
+static unsigned int createProgram(const char* vPath, const char* fPath) {
+    char* vSource = readFile(vPath); char* fSource = readFile(fPath);
+    if (!vSource || !fSource) return 0;
+    unsigned int vShader = createShader(vSource, GL_VERTEX_SHADER);
+    unsigned int fShader = createShader(fSource, GL_FRAGMENT_SHADER);
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, vShader); glAttachShader(program, fShader); glLinkProgram(program);
+    glDeleteShader(vShader); glDeleteShader(fShader); free(vSource); free(fSource);
+    return program;
+}
+
+static unsigned int loadTexture(char const * path) {
+    unsigned int textureID; glGenTextures(1, &textureID);
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    if (data) {
+        GLenum format = (nrComponents == 1) ? GL_RED : (nrComponents == 3 ? GL_RGB : GL_RGBA);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        stbi_image_free(data);
+    } else { printf("Texture failed: %s\n", path); stbi_image_free(data); }
+    return textureID;
+}
+
+static unsigned int loadCubemap(char** faces) {
+    unsigned int textureID; glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    int width, height, nrChannels;
+    for (unsigned int i = 0; i < 6; i++) {
+        unsigned char *data = stbi_load(faces[i], &width, &height, &nrChannels, 0);
+        if (data) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            stbi_image_free(data);
+        } else stbi_image_free(data);
+    }
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    return textureID;
+}
+
+static void create_resources() {
+    glEnable(GL_DEPTH_TEST);
+
+    cubeProg = createProgram("res/shaders/cube.vert", "res/shaders/cube.frag");
+    screenProg = createProgram("res/shaders/screen.vert", "res/shaders/screen.frag");
+    hudProg = createProgram("res/shaders/hud.vert", "res/shaders/hud.frag");
+    hud_init(hudProg);
+
+    skyProg = glCreateProgram();
+    unsigned int sv = createShader(skyboxVertSrc, GL_VERTEX_SHADER);
+    unsigned int sf = createShader(skyboxFragSrc, GL_FRAGMENT_SHADER);
+    glAttachShader(skyProg, sv); glAttachShader(skyProg, sf); glLinkProgram(skyProg);
+
+    float vertices[] = {
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f, 0.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+         0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+         0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+         0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+        -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+         0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+         0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+        -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+        -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f
+    };
+    unsigned int cubeVBO;
+    glGenVertexArrays(1, &cubeVAO); glGenBuffers(1, &cubeVBO);
+    glBindVertexArray(cubeVAO); glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0); glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float))); glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float))); glEnableVertexAttribArray(2);
+
+    glGenVertexArrays(1, &wallVAO); glGenBuffers(1, &instanceVBO);
+    glBindVertexArray(wallVAO); glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)0); glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(3*sizeof(float))); glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8*sizeof(float), (void*)(6*sizeof(float))); glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(CubieInstance), (void*)offsetof(CubieInstance, offset));
+    glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, sizeof(CubieInstance), (void*)offsetof(CubieInstance, cell));
+    glVertexAttribIPointer(6, 1, GL_UNSIGNED_INT, sizeof(CubieInstance), (void*)offsetof(CubieInstance, cube));
+    glVertexAttribIPointer(8, 1, GL_UNSIGNED_INT, sizeof(CubieInstance), (void*)offsetof(CubieInstance, faces));
+    for(int i=4; i<=8; i++) if(i!=7) { glEnableVertexAttribArray(i); glVertexAttribDivisor(i, 1); }
+    // The buffer texture keeps pointing at animTBO when its store is re-specified for a new wall size.
+    glGenBuffers(1, &animTBO); glGenTextures(1, &animTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, animTBO);
+    glBindTexture(GL_TEXTURE_BUFFER, animTexture); glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, animTBO);
+
+    float quadVerts[] = { -1,1,0,1, -1,-1,0,0, 1,-1,1,0, -1,1,0,1, 1,-1,1,0, 1,1,1,1 };
+    unsigned int quadVBO;
+    glGenVertexArrays(1, &quadVAO); glGenBuffers(1, &quadVBO);
+    glBindVertexArray(quadVAO); glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVerts), &quadVerts, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*)0); glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*)(2*sizeof(float))); glEnableVertexAttribArray(1);
+
+    float skyboxVertices[] = { -1,1,-1,-1,-1,-1,1,-1,-1,1,-1,-1,1,1,-1,-1,1,-1,-1,-1,1,-1,-1,-1,-1,1,-1,-1,1,-1,-1,1,1,-1,-1,1,1,-1,-1,1,-1,1,1,1,1,1,1,1,1,1,-1,1,-1,-1,-1,-1,1,-1,1,1,1,1,1,1,1,1,1,-1,1,-1,-1,1,-1,1,-1,1,1,-1,1,1,1,1,1,1,-1,1,1,-1,1,-1,-1,-1,-1,-1,-1,1,1,-1,-1,1,-1,-1,-1,-1,1,1,-1,1 };
+    unsigned int skyVBO;
+    glGenVertexArrays(1, &skyVAO); glGenBuffers(1, &skyVBO);
+    glBindVertexArray(skyVAO); glBindBuffer(GL_ARRAY_BUFFER, skyVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void*)0); glEnableVertexAttribArray(0);
+
+    glGenFramebuffers(1, &fbo); glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenTextures(1, &texColorBuffer);
+    glBindTexture(GL_TEXTURE_2D, texColorBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, scene_w, scene_h, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texColorBuffer, 0);
+    unsigned int rbo; glGenRenderbuffers(1, &rbo); glBindRenderbuffer(GL_RENDERBUFFER, rbo);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, scene_w, scene_h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rbo);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER)!=GL_FRAMEBUFFER_COMPLETE) printf("FBO Error!\n");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    cubeTexture = loadTexture(diffuse_path);
+    normalMap = loadTexture(normal_path);
+    cubemapTexture = loadCubemap(sky_faces);
+
+    glUseProgram(cubeProg);
+    glUniform1i(glGetUniformLocation(cubeProg, "texture1"), 0);
+    glUniform1i(glGetUniformLocation(cubeProg, "normalMap"), 1);
+    glUniform1i(glGetUniformLocation(cubeProg, "skybox"), 2);
+    glUniform3fv(glGetUniformLocation(cubeProg, "palette"), CUBE_COLORS, (const float*)cube_palette);
+    float orients[24][9]; cube_orientations(orients);
+    glUniformMatrix3fv(glGetUniformLocation(cubeProg, "orientations"), 24, GL_FALSE, (float*)orients);
+    glUniform1i(glGetUniformLocation(cubeProg, "animState"), 4);
+    glUniform1i(glGetUniformLocation(cubeProg, "cubeSize"), WALL_CUBE_N);
+    faceletProg = createProgram("res/shaders/facelet.vert", "res/shaders/cube.frag");
+    facelet_init(faceletProg, cubeProg, cubeVAO);
+    glUseProgram(skyProg); glUniform1i(glGetUniformLocation(skyProg, "skybox"), 0);
+    glUseProgram(screenProg); glUniform1i(glGetUniformLocation(screenProg, "screenTexture"), 0);
+}
+
+void scene_init(int width, int height) {
+    scene_w = width; scene_h = height;
+    if(!rc_is_null()) { create_resources(); rc_invalidate(); }
+    unsigned int progs[2] = {faceletProg, cubeProg};
+    for(int i=0; i<2; i++) {
+        view_loc[i] = rc_location(progs[i], "view"); proj_loc[i] = rc_location(progs[i], "projection");
+        light_loc[i] = rc_location(progs[i], "lightPos"); eye_loc[i] = rc_location(progs[i], "viewPos");
+    }
+    sky_view_loc = rc_location(skyProg, "view"); sky_proj_loc = rc_location(skyProg, "projection");
+    effect_loc = rc_location(screenProg, "effectType"); instanced_loc = rc_location(cubeProg, "instanced");
+}
+
+int scene_software(int threads) {
+    if(swr_init(scene_w, scene_h, threads, diffuse_path, normal_path, sky_faces) != 0) return -1;
+    if(!rc_is_null()) {
+        // The CPU frame is uploaded here and blitted to the target; only the HUD is drawn by GL.
+        glGenTextures(1, &swTexture); glBindTexture(GL_TEXTURE_2D, swTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, scene_w, scene_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenFramebuffers(1, &swFbo); glBindFramebuffer(GL_FRAMEBUFFER, swFbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, swTexture, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        rc_invalidate();
+    }
+    sw_active = 1;
+    return 0;
+}
+
+void scene_camera(SceneFrame* f, float yaw, float pitch, float dist, float time) {
+    mat4 camRot; glm_mat4_identity(camRot);
+    glm_rotate(camRot, glm_rad(pitch), (vec3){1,0,0}); glm_rotate(camRot, glm_rad(yaw), (vec3){0,1,0});
+    vec4 rCamPos; glm_mat4_mulv(camRot, (vec4){0,0,dist,1}, rCamPos);
+    glm_vec3(rCamPos, f->view_pos);
+    glm_mat4_identity(f->view); glm_mat4_identity(f->proj);
+    glm_lookat(f->view_pos, (vec3){0,0,0}, (vec3){0,1,0}, f->view);
+    glm_perspective(glm_rad(45.0f), (float)scene_w/scene_h, 0.1f, fmaxf(100.0f, dist*2.0f), f->proj);
+
+    float lightRadius = 15.0f;
+    f->light_pos[0] = sin(time) * lightRadius;
+    f->light_pos[1] = 10.0f;
+    f->light_pos[2] = cos(time) * lightRadius;
+}
+
+void scene_wall_resize(int count) {
+    free(wall_instances); wall_instances = malloc(sizeof(CubieInstance)*(wall_count ? wall[0].count : 27)*(size_t)count);
+    free(wall_anim); wall_anim = malloc(sizeof(WallAnim)*(size_t)count); wall_capacity = 0;
+}
+
+// The CPU rasterizer's frame, blitted over the target.
+static void draw_software(const SceneFrame* f, unsigned int target, int target_w, int target_h) {
+    SwrFrame s = { .n = f->n, .anim_axis = f->anim_axis, .effect = f->effect, .stickers = f->stickers, .anim_angles = f->anim_angles,
+                   .view_pos = {f->view_pos[0], f->view_pos[1], f->view_pos[2]}, .light_pos = {f->light_pos[0], f->light_pos[1], f->light_pos[2]} };
+    memcpy(s.view, f->view, sizeof(s.view)); memcpy(s.proj, f->proj, sizeof(s.proj));
+    const unsigned char* pixels = swr_draw(&s);
+    rc_image(swTexture, RC_RGBA8, scene_w, scene_h, pixels, 0);
+    rc_blit(swFbo, scene_w, scene_h, target, target_w, target_h);
+    rc_depth(0, RC_LESS);
+}
+
+static void draw_wall() {
+    // Per frame only the small per-cube animation buffer is uploaded; cubie instances
+    // follow when their cube finishes a turn.
+    int from, to, n = wall_build(wall_instances, wall_anim, &from, &to);
+    rc_vertex_array(wallVAO);
+    if(wall_capacity != wall_count) {
+        rc_buffer(RC_ARRAY_BUFFER, instanceVBO, -1, n*sizeof(CubieInstance), NULL);
+        rc_buffer(RC_TEXTURE_BUFFER, animTBO, -1, wall_count*sizeof(WallAnim), NULL);
+        wall_capacity = wall_count;
+    }
+    if(to > from) rc_buffer(RC_ARRAY_BUFFER, instanceVBO, (long)(from*sizeof(CubieInstance)), (to-from)*sizeof(CubieInstance), wall_instances + from);
+    rc_buffer(RC_TEXTURE_BUFFER, animTBO, 0, wall_count*sizeof(WallAnim), wall_anim);
+    rc_texture(4, RC_TEX_BUFFER, animTexture);
+    rc_uniform1i(instanced_loc, 1);
+    rc_draw(0, 36, n);
+    rc_uniform1i(instanced_loc, 0);
+}
+
+void scene_draw(const SceneFrame* f, unsigned int target, int target_w, int target_h) {
+    if(sw_active) { draw_software(f, target, target_w, target_h); return; }
+
+    rc_target(fbo);
+    rc_depth(1, RC_LESS);
+    rc_clear(0.1f, 0.1f, 0.1f, 1);
+
+    unsigned int progs[2] = {faceletProg, cubeProg};
+    for(int i=0; i<2; i++) {
+        rc_program(progs[i]);
+        rc_uniform(view_loc[i], RC_MAT4, 1, f->view); rc_uniform(proj_loc[i], RC_MAT4, 1, f->proj);
+        rc_uniform(light_loc[i], RC_VEC3, 1, f->light_pos); rc_uniform(eye_loc[i], RC_VEC3, 1, f->view_pos);
+    }
+
+    rc_texture(0, RC_TEX_2D, cubeTexture);
+    rc_texture(1, RC_TEX_2D, normalMap);
+    rc_texture(2, RC_TEX_CUBE, cubemapTexture);
+    rc_vertex_array(cubeVAO);
+    if(wall_count>0) draw_wall();
+    else facelet_draw(f->n, f->version, f->stickers, f->anim_axis, f->anim_angles);
+
+    rc_depth(1, RC_LEQUAL); rc_program(skyProg);
+    mat4 viewNoTrans; memcpy(viewNoTrans, f->view, sizeof(mat4)); viewNoTrans[3][0]=0; viewNoTrans[3][1]=0; viewNoTrans[3][2]=0;
+    rc_uniform(sky_view_loc, RC_MAT4, 1, viewNoTrans);
+    rc_uniform(sky_proj_loc, RC_MAT4, 1, f->proj);
+    rc_vertex_array(skyVAO); rc_texture(0, RC_TEX_CUBE, cubemapTexture);
+    rc_draw(0, 36, 0); rc_depth(1, RC_LESS);
+
+    rc_target(target);
+    rc_depth(0, RC_LESS);
+    rc_clear(1, 1, 1, 0);
+    rc_program(screenProg);
+    rc_vertex_array(quadVAO);
+    rc_texture(0, RC_TEX_2D, texColorBuffer);
+    rc_uniform1i(effect_loc, f->effect);
+    rc_draw(0, 6, 0);
+}
+
+unsigned int scene_framebuffer() { return fbo; }
+
+void scene_shutdown() {
+    if(sw_active) swr_shutdown();
+    sw_active = 0;
+    free(wall_instances); free(wall_anim); wall_instances = NULL; wall_anim = NULL; wall_capacity = 0;
+}
@@ -0,0 +1,34 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include <cglm/cglm.h>
+
+// The frame under the HUD: the cube (facelet renderer, or the instanced wall while
+// wall_count > 0), the skybox and the post-processing pass into the target - or, after
+// scene_software(), the CPU rasterizer's frame blitted in their place. Resources are created
+// with GL once in scene_init; frames are issued as render commands (render.h), so with the
+// null backend scene_init skips GL and scene_draw runs without a context.
+
+typedef struct {
+    mat4 view, proj; vec3 view_pos, light_pos;
+    int n, anim_axis, effect; unsigned int version;
+    const unsigned char* stickers;  // cube_stickers() layout, re-uploaded when version changes
+    const float* anim_angles;       // one angle per layer (radians), read when anim_axis >= 0
+} SceneFrame;
+
+// Programs, textures, meshes and a width x height offscreen target; also starts the HUD and
+// facelet renderers.
+void scene_init(int width, int height);
+// Switches to the CPU rasterizer (threads <= 0: one per CPU). -1 when it could not start.
+int scene_software(int threads);
+// Orbit camera at yaw/pitch (degrees) and dist, and the light circling with time (seconds).
+void scene_camera(SceneFrame* f, float yaw, float pitch, float dist, float time);
+// Instance and animation storage for a wall of count cubes; call after wall_init.
+void scene_wall_resize(int count);
+// Draws into target (0 = default framebuffer); target_w/h only matter for the software blit.
+void scene_draw(const SceneFrame* f, unsigned int target, int target_w, int target_h);
+// The offscreen target the post pass reads.
+unsigned int scene_framebuffer(void);
+void scene_shutdown(void);
+
+#endif
@@ -0,0 +1,77 @@
+#include "shmstate.h"
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static SharedCubeState* shared = NULL; static char shm_name[64];
+static int shm_fd = -1; static size_t mapped = 0;
+
+// Extends the segment to size bytes and maps it again; readers notice through size.
+static int grow(size_t size) {
+    if(ftruncate(shm_fd, (off_t)size) != 0) { printf("GRESKA: ftruncate %s: %s\n", shm_name, strerror(errno)); return -1; }
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    if(p == MAP_FAILED) { printf("GRESKA: mmap %s: %s\n", shm_name, strerror(errno)); return -1; }
+    if(shared) munmap(shared, mapped);
+    shared = p; mapped = size;
+    return 0;
+}
+
+// 1 when an existing segment is ours and its writer has exited, so it can be replaced.
+static int stale(const char* name) {
+    int fd = shm_open(name, O_RDONLY, 0); struct stat sb; int dead = 0;
+    if(fd < 0) return 0;
+    if(fstat(fd, &sb) == 0 && (size_t)sb.st_size >= sizeof(SharedCubeState)) {
+        const SharedCubeState* s = mmap(NULL, sizeof(*s), PROT_READ, MAP_SHARED, fd, 0);
+        if(s != MAP_FAILED) {
+            dead = s->magic == SHM_STATE_MAGIC && s->pid > 0 && kill(s->pid, 0) != 0 && errno == ESRCH;
+            munmap((void*)s, sizeof(*s));
+        }
+    }
+    close(fd);
+    return dead;
+}
+
+int shm_state_open(const char* name) {
+    snprintf(shm_name, sizeof(shm_name), "%s", name);
+    shm_fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(shm_fd < 0 && errno == EEXIST && stale(name)) {
+        printf("Deljena memorija %s je ostala od ugasenog procesa, pravi se nova\n", name);
+        shm_unlink(name);
+        shm_fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if(shm_fd < 0 && errno == EEXIST) { printf("GRESKA: deljena memorija %s vec postoji, a nije ostala od ugasene igre (izaberite drugo ime ili je obrisite)\n", name); return -1; }
+    if(shm_fd < 0) { printf("GRESKA: shm_open %s: %s\n", name, strerror(errno)); return -1; }
+    if(grow(sizeof(SharedCubeState)) != 0) { close(shm_fd); shm_fd = -1; shm_unlink(name); return -1; }
+    memset(shared, 0, sizeof(*shared));
+    shared->size = (unsigned int)mapped; shared->pid = (int)getpid(); shared->anim_axis = -1;
+    __atomic_store_n(&shared->magic, SHM_STATE_MAGIC, __ATOMIC_RELEASE);
+    printf("Deljena memorija: %s\n", name);
+    return 0;
+}
+
+SharedCubeState* shm_state_begin(int n) {
+    if(!shared) return NULL;
+    size_t need = shm_state_bytes(n);
+    if(need > mapped) {
+        static int failed = 0;
+        if(failed || grow(need) != 0) { failed = 1; return NULL; }
+    }
+    __atomic_store_n(&shared->seq, shared->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    shared->size = (unsigned int)mapped;
+    return shared;
+}
+
+void shm_state_end() { __atomic_store_n(&shared->seq, shared->seq + 1, __ATOMIC_RELEASE); }
+
+void shm_state_close() {
+    if(!shared) return;
+    munmap(shared, mapped); shared = NULL; mapped = 0;
+    close(shm_fd); shm_fd = -1;
+    shm_unlink(shm_name);
+}
@@ -0,0 +1,73 @@
+#ifndef SHMSTATE_H
+#define SHMSTATE_H
+
+#include <sched.h>
+#include <string.h>
+
+#include "cube.h"
+
+// Cube state published into a POSIX shared-memory segment for local observers (recorders,
+// analyzers, overlays). One writer - the simulation, once per step - and any number of
+// readers that map the segment read-only and copy it out with shm_state_read(): no syscalls
+// and no locks, a reader just retries when it overlapped a write. seq is the seqlock counter,
+// odd while a write is in progress. The header below is followed by anim_angles (n floats,
+// the current angle of every layer in radians) and stickers (the 6n^2 cube_stickers() view
+// layout); the segment is sized for the cube and grows with it, never shrinks.
+
+#define SHM_STATE_DEFAULT_NAME "/rubik_state"
+#define SHM_STATE_MAGIC 0x52554233u   // "RUB3"
+
+typedef struct {
+    unsigned int magic, size;            // size = bytes of the whole segment
+    unsigned int seq;
+    int pid;                             // writer process; a segment whose writer is gone may be reused
+    int n, game_state, anim_axis;        // anim_axis -1 when no turn is animating
+    unsigned int flags;                  // CUBE_SHM_* below
+    unsigned int total_moves, history, moves_done;
+    long long frame;
+    double time, start_time, final_time; // seconds on the simulation clock
+    float anim_progress;                 // 0..1 through the turn in flight
+} SharedCubeState;
+
+// Header plus the arrays of an n-layer cube.
+static inline size_t shm_state_bytes(int n) { return sizeof(SharedCubeState) + sizeof(float)*(size_t)n + 6*(size_t)n*n; }
+static inline float* shm_state_angles(SharedCubeState* s) { return (float*)(s + 1); }
+static inline unsigned char* shm_state_stickers(SharedCubeState* s) { return (unsigned char*)(shm_state_angles(s) + s->n); }
+
+enum { CUBE_SHM_ANIMATING = 1, CUBE_SHM_SHUFFLING = 2, CUBE_SHM_SOLVING = 4, CUBE_SHM_REPLAYING = 8 };
+
+// Creates the segment; fails rather than taking over one that exists, unless it is a segment
+// of this format left behind by a writer that is no longer running.
+int shm_state_open(const char* name);
+// Writer side: returns the segment, grown to hold an n-layer cube, to fill between
+// shm_state_begin() and shm_state_end(); NULL when publishing is off or it could not grow.
+SharedCubeState* shm_state_begin(int n);
+void shm_state_end();
+void shm_state_close();
+
+// A write takes microseconds; a reader that still has no consistent copy after this many
+// attempts assumes the writer died or stopped mid-write. Past the first few spins the reader
+// yields while seq is odd, so a writer preempted mid-write on the same core gets to finish.
+#define SHM_STATE_MAX_RETRIES 100000
+
+// Reader side: copies a consistent snapshot of src (mapped bytes of it) into dst (dst_size
+// bytes); returns the number of retries, -1 when it does not fit - the segment has grown,
+// so remap it (its current length) and size dst to match - or -2 when seq stayed odd or
+// kept changing for SHM_STATE_MAX_RETRIES attempts.
+static inline int shm_state_read(const SharedCubeState* src, size_t mapped, SharedCubeState* dst, size_t dst_size) {
+    for(int retries = 0; retries < SHM_STATE_MAX_RETRIES; retries++) {
+        unsigned int s1 = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+        if(s1 & 1) { if(retries >= 64) sched_yield(); continue; }
+        memcpy(dst, src, sizeof(*dst));
+        // n may be torn here; it is only trusted once seq has been checked again.
+        size_t need = dst->n >= 0 && dst->n <= CUBE_MAX_N ? shm_state_bytes(dst->n) : (size_t)-1;
+        if(need <= mapped && need <= dst_size) memcpy(dst + 1, src + 1, need - sizeof(*dst));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if(__atomic_load_n(&src->seq, __ATOMIC_RELAXED) != s1) continue;
+        if(need > mapped || need > dst_size) return -1;
+        dst->seq = s1; return retries;
+    }
+    return -2;
+}
+
+#endif
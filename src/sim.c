@@ -0,0 +1,87 @@
+#include "sim.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define SIM_FRESH 4u
+
+int sim_input_push(SimInputQueue* q, const SimInput* in) {
+    unsigned int tail = q->tail, head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+    if(tail - head == SIM_INPUT_QUEUE) return -1;
+    q->items[tail % SIM_INPUT_QUEUE] = *in;
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int sim_input_pop(SimInputQueue* q, SimInput* out) {
+    unsigned int head = q->head, tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+    if(head == tail) return 0;
+    *out = q->items[head % SIM_INPUT_QUEUE];
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+void sim_buffer_init(SimTripleBuffer* tb) {
+    memset(tb, 0, sizeof(*tb));
+    tb->back = 0; tb->middle = 1; tb->front = 2;
+}
+
+void sim_buffer_free(SimTripleBuffer* tb) {
+    for(int i=0; i<3; i++) { free(tb->slots[i].stickers); free(tb->slots[i].anim_angles); }
+    sim_buffer_init(tb);
+}
+
+SimSnapshot* sim_back(SimTripleBuffer* tb) { return &tb->slots[tb->back]; }
+
+int sim_snapshot_reserve(SimSnapshot* s, int n) {
+    if(n <= s->cap) return 0;
+    unsigned char* st = realloc(s->stickers, 6*(size_t)n*n);
+    if(st) s->stickers = st;
+    float* an = realloc(s->anim_angles, sizeof(float)*n);
+    if(an) s->anim_angles = an;
+    if(!st || !an) return -1;
+    s->cap = n; s->n = 0;  // contents are stale until rewritten
+    return 0;
+}
+
+void sim_publish(SimTripleBuffer* tb) {
+    tb->back = __atomic_exchange_n(&tb->middle, tb->back | SIM_FRESH, __ATOMIC_ACQ_REL) & 3u;
+}
+
+const SimSnapshot* sim_latest(SimTripleBuffer* tb) {
+    if(__atomic_load_n(&tb->middle, __ATOMIC_ACQUIRE) & SIM_FRESH) tb->front = __atomic_exchange_n(&tb->middle, tb->front, __ATOMIC_ACQ_REL) & 3u;
+    return &tb->slots[tb->front];
+}
+
+static pthread_t sim_thread; static int sim_running = 0;
+static int (*sim_tick)(void); static double sim_period;
+
+static double now() { struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return ts.tv_sec + ts.tv_nsec*1e-9; }
+
+static void* sim_main(void* arg) {
+    (void)arg;
+    double next = now();
+    while(__atomic_load_n(&sim_running, __ATOMIC_ACQUIRE)) {
+        if(!sim_tick()) { next = now(); continue; }
+        next += sim_period;
+        double left = next - now();
+        // A stall (debugger, suspended laptop) resumes at the normal rate instead of racing to catch up.
+        if(left < -0.25) next = now();
+        else if(left > 0) { struct timespec ts = {(time_t)left, (long)((left-(time_t)left)*1e9)}; nanosleep(&ts, NULL); }
+    }
+    return NULL;
+}
+
+int sim_thread_start(int (*tick)(void), double hz) {
+    sim_tick = tick; sim_period = 1.0/hz; sim_running = 1;
+    if(pthread_create(&sim_thread, NULL, sim_main, NULL) != 0) { sim_running = 0; return -1; }
+    return 0;
+}
+
+void sim_thread_stop() {
+    if(!sim_running) return;
+    __atomic_store_n(&sim_running, 0, __ATOMIC_RELEASE);
+    pthread_join(sim_thread, NULL);
+}
@@ -0,0 +1,60 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stddef.h>
+
+#include "cube.h"
+
+// Simulation/render split. The simulation side owns the cube, the move queue, sessions and
+// game state; the render side only reads the newest published SimSnapshot. Snapshots travel
+// through a lock-free triple buffer (publishing never waits, reading always yields the latest
+// complete one) and input travels the other way through a wait-free single-producer /
+// single-consumer ring. Both work the same whether the simulation runs on its own thread or
+// is stepped inline by the render loop (headless, wall mode, --low-latency).
+
+enum { SIM_INPUT_KEY, SIM_INPUT_CAMERA };
+typedef struct { int type, key; float yaw, pitch; } SimInput;
+
+#define SIM_INPUT_QUEUE 256
+
+// head is only written by the consumer, tail only by the producer.
+typedef struct { SimInput items[SIM_INPUT_QUEUE]; unsigned int head, tail; } SimInputQueue;
+
+// 0 on success, -1 when the ring is full (the event is dropped, the producer never blocks).
+int sim_input_push(SimInputQueue* q, const SimInput* in);
+// 1 when an event was taken.
+int sim_input_pop(SimInputQueue* q, SimInput* out);
+
+// Everything a frame needs to draw the single cube and the HUD. stickers is refreshed only
+// when view_version moved since this slot was last written. stickers (6n^2) and anim_angles
+// (n) are sized for cap layers by the writer, which owns the back slot.
+typedef struct {
+    long long frame;
+    int n, cap; unsigned int version;
+    unsigned char* stickers;
+    int anim_axis; float* anim_angles;
+    int game_state, total_moves, effect, replaying, busy;
+    double start_time, final_time, time;
+    int turbo_rate; size_t turbo_done, turbo_total;
+    float yaw, pitch;
+    unsigned int sounds, inputs;  // move sounds issued and input events applied so far
+} SimSnapshot;
+
+// slots[back] belongs to the writer and slots[front] to the reader; middle holds the third
+// index plus SIM_FRESH when it carries a snapshot the reader has not seen yet.
+typedef struct { SimSnapshot slots[3]; unsigned int back, middle, front; } SimTripleBuffer;
+
+void sim_buffer_init(SimTripleBuffer* tb);
+void sim_buffer_free(SimTripleBuffer* tb);
+SimSnapshot* sim_back(SimTripleBuffer* tb);
+// Grows s (the back slot) to hold an n-layer cube; -1 when out of memory.
+int sim_snapshot_reserve(SimSnapshot* s, int n);
+void sim_publish(SimTripleBuffer* tb);
+const SimSnapshot* sim_latest(SimTripleBuffer* tb);
+
+// Runs tick() on a new thread until sim_thread_stop(), waiting for the next 1/hz boundary
+// after every call that returns non-zero; -1 if the thread cannot start.
+int sim_thread_start(int (*tick)(void), double hz);
+void sim_thread_stop();
+
+#endif
@@ -0,0 +1,558 @@
+#include "swr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "stb_image.h"
+#include "cube.h"
+
+// Same insets as facelet.c, so both backends draw the same cube.
+#define STICKER_GAP 0.03f
+#define BODY_INSET 0.02f
+#define MAX_LEVELS 16
+// Reflections read a small mip of the sky: bump-mapped normals scatter them over the whole cube
+// map, and at 2048^2 per face nearly every lookup was a cache miss.
+#define REFLECT_SIZE 128
+
+// Four pixels at a time through the compiler's vector extensions: SSE on x86, NEON on ARM,
+// plain scalar code elsewhere. Comparisons yield all-ones lanes, which double as masks.
+typedef float f4 __attribute__((vector_size(16)));
+typedef int i4 __attribute__((vector_size(16)));
+
+static inline f4 f4s(float x) { return (f4){x, x, x, x}; }
+static const f4 lane = {0, 1, 2, 3};
+static inline f4 ld4(const float* p) { f4 r; memcpy(&r, p, sizeof(r)); return r; }
+static inline void st4(float* p, f4 v) { memcpy(p, &v, sizeof(v)); }
+static inline f4 sel(i4 m, f4 a, f4 b) { return (f4)(((i4)a & m) | ((i4)b & ~m)); }
+static inline f4 vmax(f4 a, f4 b) { return sel(a > b, a, b); }
+static inline f4 vmin(f4 a, f4 b) { return sel(a < b, a, b); }
+static inline int any(i4 m) { return (m[0] | m[1] | m[2] | m[3]) != 0; }
+static inline f4 rsqrt4(f4 x) {
+#ifdef __SSE__
+    f4 r = (f4)_mm_rsqrt_ps((__m128)x);
+    return r * (f4s(1.5f) - f4s(0.5f) * x * r * r);
+#else
+    return f4s(1.0f) / (f4){sqrtf(x[0]), sqrtf(x[1]), sqrtf(x[2]), sqrtf(x[3])};
+#endif
+}
+static inline f4 channel(i4 px, int shift) { return __builtin_convertvector((px >> shift) & 255, f4) * f4s(1.0f/255.0f); }
+
+// Texels are packed r | g<<8 | b<<16 throughout.
+typedef struct { int w, h; unsigned int* px; } Level;
+typedef struct { int levels; float bias; Level lv[MAX_LEVELS]; } Texture;
+
+// Planes are evaluated at pixel centres: value = c + dx*x + dy*y for integer x, y.
+typedef struct { float dx, dy, c; } Plane;
+typedef struct {
+    Plane e[3], z, iw, u, v, p[3];  // barycentrics, then attributes (u, v, p divided by w)
+    float tbn[9], color[3], lod;
+    int x0, y0, x1, y1;
+} Tri;
+typedef struct { float x, y, z, iw, p[3], u, v; } Vert;
+typedef struct { float depth[SWR_TILE*SWR_TILE]; unsigned int color[SWR_TILE*SWR_TILE]; } TileBuf;
+
+static int width, height, tiles_x, tiles_y;
+static Texture diffuse_tex, normal_tex, sky[6]; static int reflect_level;
+static unsigned char* frame_px;
+static Tri* tris; static int tri_count, tri_cap;
+static float* layer_sc; static int layer_cap;  // sin of every layer angle, then cos
+static int *bin_start, *bin_fill, *bin_tris; static int bin_cap;
+static float vp[16], eye[3], light[3], sky_ray[3][4]; static int effect;
+
+static pthread_t workers[SWR_MAX_THREADS]; static TileBuf* tile_bufs; static int thread_count = 0;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_wake = PTHREAD_COND_INITIALIZER, pool_done = PTHREAD_COND_INITIALIZER;
+static unsigned int pool_frame = 0; static int pool_busy = 0, pool_quit = 0, next_tile = 0;
+
+static int load_texture(const char* path, Texture* t, int mips) {
+    int w, h, comp;
+    unsigned char* data = stbi_load(path, &w, &h, &comp, 4);
+    if(!data) { printf("Texture failed: %s\n", path); return -1; }
+    t->levels = 0; t->bias = log2f((float)(w > h ? w : h));
+    for(;;) {
+        Level* l = &t->lv[t->levels++];
+        l->w = w; l->h = h; l->px = malloc(sizeof(unsigned int)*(size_t)w*h);
+        if(!l->px) { stbi_image_free(data); return -1; }
+        if(t->levels == 1) for(int i=0; i<w*h; i++) l->px[i] = data[i*4] | data[i*4+1]<<8 | data[i*4+2]<<16;
+        else {
+            // 2x2 box filter of the previous level.
+            const Level* s = l - 1;
+            for(int y=0; y<h; y++) for(int x=0; x<w; x++) {
+                int x0 = x*2 < s->w ? x*2 : s->w-1, x1 = x*2+1 < s->w ? x*2+1 : s->w-1;
+                int y0 = y*2 < s->h ? y*2 : s->h-1, y1 = y*2+1 < s->h ? y*2+1 : s->h-1;
+                unsigned int q[4] = { s->px[y0*s->w+x0], s->px[y0*s->w+x1], s->px[y1*s->w+x0], s->px[y1*s->w+x1] }, out = 0;
+                for(int c=0; c<24; c+=8) out |= (((q[0]>>c&255) + (q[1]>>c&255) + (q[2]>>c&255) + (q[3]>>c&255) + 2) / 4) << c;
+                l->px[y*w+x] = out;
+            }
+        }
+        if(!mips || (w == 1 && h == 1) || t->levels == MAX_LEVELS) break;
+        w = w > 1 ? w/2 : 1; h = h > 1 ? h/2 : 1;
+    }
+    stbi_image_free(data);
+    return 0;
+}
+
+static void free_texture(Texture* t) { for(int i=0; i<t->levels; i++) free(t->lv[i].px); t->levels = 0; }
+
+// Major, s and t axes of each cube map face as +-(axis+1), faces in +X, -X, +Y, -Y, +Z, -Z
+// order (the GL cube map table).
+static const int face_axes[6][3] = { {1, -3, -2}, {-1, 3, -2}, {2, 1, 3}, {-2, 1, -3}, {3, 1, -2}, {-3, -1, -2} };
+
+static int sky_face(float x, float y, float z) {
+    float ax = fabsf(x), ay = fabsf(y), az = fabsf(z);
+    if(ax >= ay && ax >= az) return x > 0 ? 0 : 1;
+    if(ay >= az) return y > 0 ? 2 : 3;
+    return z > 0 ? 4 : 5;
+}
+
+static inline float axis1(const float* d, int a) { return a > 0 ? d[a-1] : -d[-a-1]; }
+static inline f4 axis4(const f4* d, int a) { return a > 0 ? d[a-1] : -d[-a-1]; }
+
+// Nearest texel of the cube map level in direction x, y, z.
+static unsigned int sky_texel(float x, float y, float z, int level) {
+    float d[3] = {x, y, z}; int f = sky_face(x, y, z);
+    const int* a = face_axes[f];
+    float ma = axis1(d, a[0]);
+    if(!(ma > 0)) return 0;
+    const Level* l = &sky[f].lv[level < sky[f].levels ? level : sky[f].levels-1];
+    float k = 0.5f/ma, s = (axis1(d, a[1])*k + 0.5f)*l->w, t = (axis1(d, a[2])*k + 0.5f)*l->h;
+    int si = s < 0 ? 0 : s >= l->w ? l->w-1 : (int)s, ti = t < 0 ? 0 : t >= l->h ? l->h-1 : (int)t;
+    return l->px[ti*l->w + si];
+}
+
+// Four directions known to fall on face f, level 0.
+static i4 sky_texel4(const f4* d, int f) {
+    const int* a = face_axes[f]; const Level* l = &sky[f].lv[0];
+    f4 k = f4s(0.5f) / axis4(d, a[0]), wf = f4s((float)l->w), hf = f4s((float)l->h);
+    i4 s = __builtin_convertvector(vmin(vmax((axis4(d, a[1])*k + f4s(0.5f))*wf, f4s(0)), wf - f4s(1)), i4);
+    i4 t = __builtin_convertvector(vmin(vmax((axis4(d, a[2])*k + f4s(0.5f))*hf, f4s(0)), hf - f4s(1)), i4);
+    i4 idx = t * l->w + s;
+    return (i4){ (int)l->px[idx[0]], (int)l->px[idx[1]], (int)l->px[idx[2]], (int)l->px[idx[3]] };
+}
+
+// Any four directions, at reflect_level: the face table above written out as lane selects.
+static i4 reflect4(f4 x, f4 y, f4 z) {
+    f4 ax = vmax(x, -x), ay = vmax(y, -y), az = vmax(z, -z), zero = f4s(0);
+    i4 mx = (ax >= ay) & (ax >= az), my = ~mx & (ay >= az), one = {1, 1, 1, 1};
+    i4 px = x > zero, py = y > zero, pz = z > zero;
+    f4 ma = sel(mx, ax, sel(my, ay, az));
+    f4 sc = sel(mx, sel(px, -z, z), sel(my | pz, x, -x));
+    f4 tc = sel(my, sel(py, z, -z), -y);
+    i4 face = (mx & (~px & one)) | (my & ((~py & one) + 2)) | (~mx & ~my & ((~pz & one) + 4));
+    const Level* l = &sky[0].lv[reflect_level];
+    f4 k = f4s(0.5f) / ma, wf = f4s((float)l->w), hf = f4s((float)l->h);
+    i4 s = __builtin_convertvector(vmin(vmax((sc*k + f4s(0.5f))*wf, zero), wf - f4s(1)), i4);
+    i4 t = __builtin_convertvector(vmin(vmax((tc*k + f4s(0.5f))*hf, zero), hf - f4s(1)), i4);
+    i4 idx = t * l->w + s;
+    return (i4){ (int)sky[face[0]].lv[reflect_level].px[idx[0]], (int)sky[face[1]].lv[reflect_level].px[idx[1]],
+                 (int)sky[face[2]].lv[reflect_level].px[idx[2]], (int)sky[face[3]].lv[reflect_level].px[idx[3]] };
+}
+
+// Nearest texel of the mip level closest to lod (log2 texels per pixel for a 1x1 texture).
+static i4 fetch4(const Texture* t, float lod, f4 u, f4 v) {
+    int li = (int)(lod + t->bias + 0.5f);
+    const Level* l = &t->lv[li < 0 ? 0 : li >= t->levels ? t->levels-1 : li];
+    f4 wf = f4s((float)l->w), hf = f4s((float)l->h);
+    i4 x = __builtin_convertvector(vmin(vmax(u*wf, f4s(0)), wf - f4s(1)), i4);
+    i4 y = __builtin_convertvector(vmin(vmax(v*hf, f4s(0)), hf - f4s(1)), i4);
+    i4 idx = y * l->w + x;
+    return (i4){ (int)l->px[idx[0]], (int)l->px[idx[1]], (int)l->px[idx[2]], (int)l->px[idx[3]] };
+}
+
+static inline f4 plane4(const Plane* p, f4 x, float y) { return f4s(p->c + p->dy*y) + f4s(p->dx)*x; }
+
+// cube.frag for the lanes in m, written over out.
+static void shade(const Tri* t, f4 x, float y, i4 m, unsigned int* out) {
+    f4 w = f4s(1.0f) / plane4(&t->iw, x, y);
+    f4 u = plane4(&t->u, x, y)*w, v = plane4(&t->v, x, y)*w;
+    f4 px = plane4(&t->p[0], x, y)*w, py = plane4(&t->p[1], x, y)*w, pz = plane4(&t->p[2], x, y)*w;
+
+    i4 nt = fetch4(&normal_tex, t->lod, u, v);
+    f4 tx = channel(nt, 0)*f4s(2) - f4s(1), ty = channel(nt, 8)*f4s(2) - f4s(1), tz = channel(nt, 16)*f4s(2) - f4s(1);
+    const float* b = t->tbn;
+    f4 nx = f4s(b[0])*tx + f4s(b[3])*ty + f4s(b[6])*tz;
+    f4 ny = f4s(b[1])*tx + f4s(b[4])*ty + f4s(b[7])*tz;
+    f4 nz = f4s(b[2])*tx + f4s(b[5])*ty + f4s(b[8])*tz;
+    f4 k = rsqrt4(nx*nx + ny*ny + nz*nz); nx *= k; ny *= k; nz *= k;
+
+    f4 lx = f4s(light[0]) - px, ly = f4s(light[1]) - py, lz = f4s(light[2]) - pz;
+    k = rsqrt4(lx*lx + ly*ly + lz*lz); lx *= k; ly *= k; lz *= k;
+    f4 vx = f4s(eye[0]) - px, vy = f4s(eye[1]) - py, vz = f4s(eye[2]) - pz;
+    k = rsqrt4(vx*vx + vy*vy + vz*vz); vx *= k; vy *= k; vz *= k;
+    f4 hx = lx + vx, hy = ly + vy, hz = lz + vz;
+    k = rsqrt4(hx*hx + hy*hy + hz*hz);
+
+    f4 diff = vmax(nx*lx + ny*ly + nz*lz, f4s(0));
+    f4 spec = vmax((nx*hx + ny*hy + nz*hz)*k, f4s(0));
+    spec *= spec; spec *= spec; spec *= spec; spec *= spec; spec *= spec;
+    spec *= f4s(0.5f);
+
+    f4 nv2 = f4s(2)*(nx*vx + ny*vy + nz*vz);
+    f4 rx = nv2*nx - vx, ry = nv2*ny - vy, rz = nv2*nz - vz;
+    i4 refl = reflect4(rx, ry, rz);
+
+    i4 dt = fetch4(&diffuse_tex, t->lod, u, v);
+    f4 light_k = f4s(0.3f) + diff;
+    f4 r = (channel(dt, 0)*f4s(0.3f) + f4s(t->color[0]*0.7f))*light_k + spec + channel(refl, 0)*f4s(0.3f);
+    f4 g = (channel(dt, 8)*f4s(0.3f) + f4s(t->color[1]*0.7f))*light_k + spec + channel(refl, 8)*f4s(0.3f);
+    f4 bl = (channel(dt, 16)*f4s(0.3f) + f4s(t->color[2]*0.7f))*light_k + spec + channel(refl, 16)*f4s(0.3f);
+
+    f4 one = f4s(1), zero = f4s(0), s255 = f4s(255.0f), half = f4s(0.5f);
+    i4 ri = __builtin_convertvector(vmin(vmax(r, zero), one)*s255 + half, i4);
+    i4 gi = __builtin_convertvector(vmin(vmax(g, zero), one)*s255 + half, i4);
+    i4 bi = __builtin_convertvector(vmin(vmax(bl, zero), one)*s255 + half, i4);
+    i4 packed = ri | gi << 8 | bi << 16, old;
+    memcpy(&old, out, sizeof(old));
+    packed = (packed & m) | (old & ~m);
+    memcpy(out, &packed, sizeof(packed));
+}
+
+static void draw_tri(TileBuf* tb, const Tri* t, int ox, int oy, int tw, int th) {
+    int x0 = t->x0 > ox ? t->x0 : ox, x1 = t->x1 < ox+tw-1 ? t->x1 : ox+tw-1;
+    int y0 = t->y0 > oy ? t->y0 : oy, y1 = t->y1 < oy+th-1 ? t->y1 : oy+th-1;
+    for(int y=y0; y<=y1; y++) {
+        float fy = (float)y, lo = (float)x0, hi = (float)x1, r[3];
+        // Exact span of the row inside all three edges; the vector test below stays authoritative.
+        int empty = 0;
+        for(int i=0; i<3; i++) {
+            r[i] = t->e[i].c + t->e[i].dy*fy;
+            float d = t->e[i].dx;
+            if(d > 0) lo = fmaxf(lo, -r[i]/d);
+            else if(d < 0) hi = fminf(hi, -r[i]/d);
+            else if(r[i] < 0) empty = 1;
+        }
+        if(empty || lo > hi+1.0f) continue;
+        int xa = (int)floorf(lo) - 1, xb = (int)ceilf(hi) + 1;
+        if(xa < x0) xa = x0;
+        if(xb > x1) xb = x1;
+        float* depth = tb->depth + (y-oy)*SWR_TILE - ox;
+        unsigned int* color = tb->color + (y-oy)*SWR_TILE - ox;
+        for(int x = ox + ((xa-ox) & ~3); x<=xb; x+=4) {
+            f4 fx = f4s((float)x) + lane;
+            i4 m = (f4s(r[0]) + f4s(t->e[0].dx)*fx >= f4s(0)) & (f4s(r[1]) + f4s(t->e[1].dx)*fx >= f4s(0)) & (f4s(r[2]) + f4s(t->e[2].dx)*fx >= f4s(0));
+            if(!any(m)) continue;
+            f4 z = plane4(&t->z, fx, fy), zb = ld4(depth + x);
+            m &= z < zb;
+            if(!any(m)) continue;
+            st4(depth + x, sel(m, z, zb));
+            shade(t, fx, fy, m, color + x);
+        }
+    }
+}
+
+// Sky behind uncovered pixels, then screen.frag, into the bottom-up output image.
+static void resolve(const TileBuf* tb, int ox, int oy, int tw, int th) {
+    // Face regions of the cube map are convex on screen, so a tile whose corners all see one
+    // face lies inside it and needs no per-pixel face selection.
+    int face = -1;
+    for(int i=0; i<4; i++) {
+        float sx = (float)(i & 1 ? ox+tw-1 : ox), sy = (float)(i & 2 ? oy+th-1 : oy), d[3];
+        for(int k=0; k<3; k++) d[k] = sky_ray[k][0] + sky_ray[k][1]*sx + sky_ray[k][2]*sy;
+        int f = sky_face(d[0], d[1], d[2]);
+        if(i == 0) face = f; else if(f != face) face = -1;
+    }
+    for(int y=0; y<th; y++) {
+        float sy = (float)(oy+y), v = (sy+0.5f)/height - 0.5f;
+        unsigned char* row = frame_px + ((size_t)(height-1-(oy+y))*width + ox)*4;
+        for(int x=0; x<tw; x+=4) {
+            int i = y*SWR_TILE + x;
+            f4 fx = f4s((float)(ox+x)) + lane;
+            i4 c, m = ld4(tb->depth + i) >= f4s(1.0f);
+            memcpy(&c, tb->color + i, sizeof(c));
+            if(any(m)) {
+                f4 d[3]; i4 sk;
+                for(int k=0; k<3; k++) d[k] = f4s(sky_ray[k][0] + sky_ray[k][2]*sy) + f4s(sky_ray[k][1])*fx;
+                if(face >= 0) sk = sky_texel4(d, face);
+                else for(int j=0; j<4; j++) sk[j] = (int)sky_texel(d[0][j], d[1][j], d[2][j], 0);
+                c = (sk & m) | (c & ~m);
+            }
+            if(effect == 1) c = ~c & 0xFFFFFF;
+            else if(effect == 2) {
+                // 1 - smoothstep(0.4, 1.5, distance from the centre)
+                f4 u = (fx + f4s(0.5f))*f4s(1.0f/width) - f4s(0.5f), len = u*u + f4s(v*v);
+                len *= rsqrt4(vmax(len, f4s(1e-12f)));
+                f4 t = vmin(vmax((len - f4s(0.4f))*f4s(1.0f/1.1f), f4s(0)), f4s(1)), k = (f4s(1) - t*t*(f4s(3) - f4s(2)*t))*f4s(255);
+                i4 r = __builtin_convertvector(channel(c, 0)*k + f4s(0.5f), i4);
+                i4 g = __builtin_convertvector(channel(c, 8)*k + f4s(0.5f), i4);
+                i4 b = __builtin_convertvector(channel(c, 16)*k + f4s(0.5f), i4);
+                c = r | g << 8 | b << 16;
+            } else if(effect == 3) {
+                i4 l = __builtin_convertvector((channel(c, 0)*f4s(0.2126f) + channel(c, 8)*f4s(0.7152f) + channel(c, 16)*f4s(0.0722f))*f4s(255) + f4s(0.5f), i4);
+                c = l | l << 8 | l << 16;
+            }
+            c |= (i4){-16777216, -16777216, -16777216, -16777216};  // alpha 255
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            if(x+4 <= tw) { memcpy(row + x*4, &c, sizeof(c)); continue; }
+#endif
+            for(int j=0; j<4 && x+j<tw; j++) {
+                unsigned char* o = row + (x+j)*4;
+                o[0] = (unsigned char)c[j]; o[1] = (unsigned char)(c[j] >> 8); o[2] = (unsigned char)(c[j] >> 16); o[3] = 255;
+            }
+        }
+    }
+}
+
+static void raster_tile(TileBuf* tb, int tile) {
+    int ox = (tile % tiles_x)*SWR_TILE, oy = (tile / tiles_x)*SWR_TILE;
+    int tw = width-ox < SWR_TILE ? width-ox : SWR_TILE, th = height-oy < SWR_TILE ? height-oy : SWR_TILE;
+    for(int i=0; i<SWR_TILE*SWR_TILE; i++) tb->depth[i] = 1.0f;
+    for(int i=bin_start[tile]; i<bin_start[tile+1]; i++) draw_tri(tb, &tris[bin_tris[i]], ox, oy, tw, th);
+    resolve(tb, ox, oy, tw, th);
+}
+
+static void run_tiles(TileBuf* tb) {
+    for(int t; (t = __atomic_fetch_add(&next_tile, 1, __ATOMIC_RELAXED)) < tiles_x*tiles_y; ) raster_tile(tb, t);
+}
+
+static void* worker_main(void* arg) {
+    TileBuf* tb = arg; unsigned int seen = 0;
+    pthread_mutex_lock(&pool_lock);
+    for(;;) {
+        while(seen == pool_frame && !pool_quit) pthread_cond_wait(&pool_wake, &pool_lock);
+        if(pool_quit) break;
+        seen = pool_frame;
+        pthread_mutex_unlock(&pool_lock);
+        run_tiles(tb);
+        pthread_mutex_lock(&pool_lock);
+        if(--pool_busy == 0) pthread_cond_signal(&pool_done);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+static int project(const float p[3], float u, float v, Vert* o) {
+    float x = vp[0]*p[0] + vp[4]*p[1] + vp[8]*p[2] + vp[12];
+    float y = vp[1]*p[0] + vp[5]*p[1] + vp[9]*p[2] + vp[13];
+    float z = vp[2]*p[0] + vp[6]*p[1] + vp[10]*p[2] + vp[14];
+    float w = vp[3]*p[0] + vp[7]*p[1] + vp[11]*p[2] + vp[15];
+    if(w < 1e-3f) return 0;  // behind the camera; the cube never gets that close
+    float iw = 1.0f/w;
+    o->x = (x*iw*0.5f + 0.5f)*width; o->y = (0.5f - y*iw*0.5f)*height; o->z = z*iw; o->iw = iw;
+    memcpy(o->p, p, sizeof(o->p)); o->u = u; o->v = v;
+    return 1;
+}
+
+static void set_plane(Plane* out, const Plane* e, float a, float b, float c) {
+    out->dx = a*e[0].dx + b*e[1].dx + c*e[2].dx;
+    out->dy = a*e[0].dy + b*e[1].dy + c*e[2].dy;
+    out->c = a*e[0].c + b*e[1].c + c*e[2].c;
+}
+
+static void add_tri(const Vert* a, const Vert* b, const Vert* c, const float tbn[9], const float color[3]) {
+    const Vert* v[3] = {a, b, c};
+    float area = (b->x-a->x)*(c->y-a->y) - (b->y-a->y)*(c->x-a->x);
+    if(fabsf(area) < 1e-6f) return;
+    float xmin = fminf(a->x, fminf(b->x, c->x)), xmax = fmaxf(a->x, fmaxf(b->x, c->x));
+    float ymin = fminf(a->y, fminf(b->y, c->y)), ymax = fmaxf(a->y, fmaxf(b->y, c->y));
+    if(xmax < 0 || ymax < 0 || xmin > width || ymin > height) return;
+    if(tri_count == tri_cap) {
+        int cap = tri_cap ? tri_cap*2 : 4096;
+        Tri* nt = realloc(tris, sizeof(Tri)*(size_t)cap);
+        if(!nt) return;
+        tris = nt; tri_cap = cap;
+    }
+    Tri* t = &tris[tri_count++];
+    t->x0 = xmin < 0 ? 0 : (int)xmin; t->x1 = xmax >= width ? width-1 : (int)xmax;
+    t->y0 = ymin < 0 ? 0 : (int)ymin; t->y1 = ymax >= height ? height-1 : (int)ymax;
+    // Barycentric i is the edge function of the opposite edge over the signed area, so it is
+    // positive inside whatever the winding. Shifted by half a pixel to sample pixel centres.
+    float ia = 1.0f/area;
+    for(int i=0; i<3; i++) {
+        const Vert *p = v[(i+1)%3], *q = v[(i+2)%3];
+        Plane* e = &t->e[i];
+        e->dx = -(q->y - p->y)*ia; e->dy = (q->x - p->x)*ia;
+        e->c = ((q->y - p->y)*p->x - (q->x - p->x)*p->y)*ia + 0.5f*(e->dx + e->dy);
+    }
+    set_plane(&t->z, t->e, a->z, b->z, c->z);
+    set_plane(&t->iw, t->e, a->iw, b->iw, c->iw);
+    set_plane(&t->u, t->e, a->u*a->iw, b->u*b->iw, c->u*c->iw);
+    set_plane(&t->v, t->e, a->v*a->iw, b->v*b->iw, c->v*c->iw);
+    for(int k=0; k<3; k++) set_plane(&t->p[k], t->e, a->p[k]*a->iw, b->p[k]*b->iw, c->p[k]*c->iw);
+    memcpy(t->tbn, tbn, sizeof(t->tbn)); memcpy(t->color, color, sizeof(t->color));
+    // One mip level per triangle, from its texture-to-screen area ratio.
+    float uv_area = fabsf((b->u-a->u)*(c->v-a->v) - (b->v-a->v)*(c->u-a->u));
+    t->lod = uv_area > 0 ? 0.5f*log2f(uv_area/fabsf(area)) : 0.0f;
+}
+
+static void turn(float* p, int axis, float s, float k) {
+    int b = (axis+1)%3, c = (axis+2)%3;
+    float pb = p[b], pc = p[c];
+    p[b] = k*pb - s*pc; p[c] = s*pb + k*pc;
+}
+
+// TBN as cube.vert builds it from the normal.
+static void make_tbn(const float n[3], float* m) {
+    float up[3] = {0, 1, 0};
+    if(fabsf(n[1]) >= 0.999f) { up[0] = 1; up[1] = 0; }
+    float t[3] = { up[1]*n[2] - up[2]*n[1], up[2]*n[0] - up[0]*n[2], up[0]*n[1] - up[1]*n[0] };
+    float l = 1.0f/sqrtf(t[0]*t[0] + t[1]*t[1] + t[2]*t[2]);
+    for(int i=0; i<3; i++) t[i] *= l;
+    m[0] = t[0]; m[1] = t[1]; m[2] = t[2];
+    m[3] = n[1]*t[2] - n[2]*t[1]; m[4] = n[2]*t[0] - n[0]*t[2]; m[5] = n[0]*t[1] - n[1]*t[0];
+    m[6] = n[0]; m[7] = n[1]; m[8] = n[2];
+}
+
+// Quad over the four corners (in grid units, centred), turned and scaled to world space.
+// Quads facing away from the eye are dropped: the cube is closed.
+static void add_quad(float corners[4][3], const float uv[4][2], float normal[3], int axis, float s, float k, float scale, const float color[3]) {
+    if(s != 0) turn(normal, axis, s, k);
+    for(int i=0; i<4; i++) {
+        if(s != 0) turn(corners[i], axis, s, k);
+        for(int j=0; j<3; j++) corners[i][j] *= scale;
+    }
+    if(normal[0]*(eye[0]-corners[0][0]) + normal[1]*(eye[1]-corners[0][1]) + normal[2]*(eye[2]-corners[0][2]) <= 0) return;
+    Vert v[4]; float tbn[9];
+    for(int i=0; i<4; i++) if(!project(corners[i], uv[i][0], uv[i][1], &v[i])) return;
+    make_tbn(normal, tbn);
+    add_tri(&v[0], &v[1], &v[2], tbn, color);
+    add_tri(&v[2], &v[3], &v[0], tbn, color);
+}
+
+static const float quad_uv[4][2] = { {0, 0}, {1, 0}, {1, 1}, {0, 1} };
+
+static void add_stickers(const SwrFrame* f, const float* sn, const float* cs) {
+    int n = f->n; float scale = 3.0f/n, half = 0.5f*n, span = 1.0f - 2.0f*STICKER_GAP;
+    for(int face=0; face<6; face++) {
+        int a = face/2, side = face%2, b = (a+1)%3, c = (a+2)%3;
+        for(int u=0; u<n; u++) for(int v=0; v<n; v++) {
+            float s = 0, k = 1;
+            if(f->anim_axis >= 0) {
+                int layer = f->anim_axis == a ? side*(n-1) : f->anim_axis == b ? u : v;
+                s = sn[layer]; k = cs[layer];
+            }
+            float corners[4][3], normal[3] = {0, 0, 0};
+            normal[a] = side ? 1.0f : -1.0f;
+            for(int i=0; i<4; i++) {
+                corners[i][a] = side*n - half;
+                corners[i][b] = u + STICKER_GAP + span*quad_uv[i][0] - half;
+                corners[i][c] = v + STICKER_GAP + span*quad_uv[i][1] - half;
+            }
+            add_quad(corners, quad_uv, normal, f->anim_axis, s, k, scale, cube_palette[f->stickers[(face*n + u)*n + v]]);
+        }
+    }
+}
+
+// Body box over layers l0..l1 of axis, as facelet.c draw_body().
+static void add_body(int n, int axis, int l0, int l1, float s, float k) {
+    float lo[3], hi[3], half = 0.5f*n;
+    for(int i=0; i<3; i++) { lo[i] = BODY_INSET; hi[i] = n - BODY_INSET; }
+    if(l0 > 0) lo[axis] = (float)l0;
+    if(l1 < n-1) hi[axis] = (float)(l1+1);
+    for(int face=0; face<6; face++) {
+        int a = face/2, side = face%2, b = (a+1)%3, c = (a+2)%3;
+        float corners[4][3], normal[3] = {0, 0, 0};
+        normal[a] = side ? 1.0f : -1.0f;
+        for(int i=0; i<4; i++) {
+            corners[i][a] = (side ? hi[a] : lo[a]) - half;
+            corners[i][b] = lo[b] + (hi[b]-lo[b])*quad_uv[i][0] - half;
+            corners[i][c] = lo[c] + (hi[c]-lo[c])*quad_uv[i][1] - half;
+        }
+        add_quad(corners, quad_uv, normal, axis, s, k, 3.0f/n, cube_palette[CUBE_BLACK]);
+    }
+}
+
+static void bin_triangles(void) {
+    int tiles = tiles_x*tiles_y, total = 0;
+    memset(bin_start, 0, sizeof(int)*(size_t)(tiles+1));
+    for(int i=0; i<tri_count; i++) {
+        const Tri* t = &tris[i];
+        for(int ty=t->y0/SWR_TILE; ty<=t->y1/SWR_TILE; ty++) for(int tx=t->x0/SWR_TILE; tx<=t->x1/SWR_TILE; tx++) bin_start[ty*tiles_x+tx+1]++;
+    }
+    for(int i=0; i<tiles; i++) { bin_fill[i] = total; total += bin_start[i+1]; bin_start[i+1] = total; }
+    if(total > bin_cap) {
+        int* nb = realloc(bin_tris, sizeof(int)*(size_t)total);
+        if(!nb) { memset(bin_start, 0, sizeof(int)*(size_t)(tiles+1)); return; }
+        bin_tris = nb; bin_cap = total;
+    }
+    for(int i=0; i<tri_count; i++) {
+        const Tri* t = &tris[i];
+        for(int ty=t->y0/SWR_TILE; ty<=t->y1/SWR_TILE; ty++) for(int tx=t->x0/SWR_TILE; tx<=t->x1/SWR_TILE; tx++) bin_tris[bin_fill[ty*tiles_x+tx]++] = i;
+    }
+}
+
+int swr_init(int w, int h, int threads, const char* diffuse, const char* normal_map, char** sky_faces) {
+    width = w; height = h;
+    tiles_x = (w + SWR_TILE-1)/SWR_TILE; tiles_y = (h + SWR_TILE-1)/SWR_TILE;
+    if(threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    threads = threads < 1 ? 1 : threads > SWR_MAX_THREADS ? SWR_MAX_THREADS : threads;
+    thread_count = 1;
+    frame_px = malloc((size_t)w*h*4);
+    bin_start = malloc(sizeof(int)*(size_t)(tiles_x*tiles_y+1)); bin_fill = malloc(sizeof(int)*(size_t)(tiles_x*tiles_y));
+    tile_bufs = malloc(sizeof(TileBuf)*(size_t)threads);
+    if(!frame_px || !bin_start || !bin_fill || !tile_bufs) { swr_shutdown(); return -1; }
+    if(load_texture(diffuse, &diffuse_tex, 1) || load_texture(normal_map, &normal_tex, 1)) { swr_shutdown(); return -1; }
+    for(int i=0; i<6; i++) if(load_texture(sky_faces[i], &sky[i], 1)) { swr_shutdown(); return -1; }
+    for(reflect_level = 0; reflect_level+1 < sky[0].levels && sky[0].lv[reflect_level].w > REFLECT_SIZE; reflect_level++);
+    for(int i=1; i<6; i++) if(sky[i].levels <= reflect_level || sky[i].lv[reflect_level].w != sky[0].lv[reflect_level].w || sky[i].lv[reflect_level].h != sky[0].lv[reflect_level].h) {
+        printf("GRESKA: strane skybox-a nisu iste velicine\n"); swr_shutdown(); return -1;
+    }
+    pool_quit = 0;
+    while(thread_count < threads && pthread_create(&workers[thread_count], NULL, worker_main, &tile_bufs[thread_count]) == 0) thread_count++;
+    return 0;
+}
+
+const unsigned char* swr_draw(const SwrFrame* f) {
+    mat4 view, proj, m, inv;
+    memcpy(view, f->view, sizeof(view)); memcpy(proj, f->proj, sizeof(proj));
+    glm_mat4_mul(proj, view, m); memcpy(vp, m, sizeof(vp));
+    memcpy(eye, f->view_pos, sizeof(eye)); memcpy(light, f->light_pos, sizeof(light));
+    effect = f->effect;
+
+    // Sky ray per pixel centre: the far-plane point of the translation-free view, which is
+    // affine in screen x and y before the divide. Only the direction matters.
+    view[3][0] = view[3][1] = view[3][2] = 0;
+    glm_mat4_mul(proj, view, m); glm_mat4_inv(m, inv);
+    float nx = 1.0f/width - 1.0f, ny = 1.0f - 1.0f/height, sx = 2.0f/width, sy = -2.0f/height;
+    float base[4], sign;
+    for(int k=0; k<4; k++) base[k] = inv[0][k]*nx + inv[1][k]*ny + inv[2][k] + inv[3][k];
+    sign = base[3] + inv[0][3]*sx*0.5f*width + inv[1][3]*sy*0.5f*height < 0 ? -1.0f : 1.0f;
+    for(int k=0; k<3; k++) { sky_ray[k][0] = sign*base[k]; sky_ray[k][1] = sign*inv[0][k]*sx; sky_ray[k][2] = sign*inv[1][k]*sy; }
+
+    // Stickers go first so the body behind them mostly fails the depth test before shading.
+    int n = f->n;
+    if(n > layer_cap) {
+        float* p = realloc(layer_sc, sizeof(float)*2*(size_t)n);
+        if(!p) return frame_px;
+        layer_sc = p; layer_cap = n;
+    }
+    float *sn = layer_sc, *cs = layer_sc + n;
+    for(int l=0; l<n; l++) { float a = f->anim_axis >= 0 ? f->anim_angles[l] : 0.0f; sn[l] = sinf(a); cs[l] = cosf(a); }
+    tri_count = 0;
+    add_stickers(f, sn, cs);
+    if(f->anim_axis < 0) add_body(n, 0, 0, n-1, 0, 1);
+    else for(int l0=0, l1; l0<n; l0=l1+1) {
+        for(l1=l0; l1+1<n && f->anim_angles[l1+1]==f->anim_angles[l0]; l1++);
+        add_body(n, f->anim_axis, l0, l1, sn[l0], cs[l0]);
+    }
+    bin_triangles();
+
+    pthread_mutex_lock(&pool_lock);
+    next_tile = 0; pool_busy = thread_count-1; pool_frame++;
+    pthread_cond_broadcast(&pool_wake);
+    pthread_mutex_unlock(&pool_lock);
+    run_tiles(&tile_bufs[0]);
+    pthread_mutex_lock(&pool_lock);
+    while(pool_busy > 0) pthread_cond_wait(&pool_done, &pool_lock);
+    pthread_mutex_unlock(&pool_lock);
+    return frame_px;
+}
+
+int swr_threads(void) { return thread_count; }
+
+void swr_shutdown(void) {
+    pthread_mutex_lock(&pool_lock); pool_quit = 1; pthread_cond_broadcast(&pool_wake); pthread_mutex_unlock(&pool_lock);
+    for(int i=1; i<thread_count; i++) pthread_join(workers[i], NULL);
+    thread_count = 0;
+    free_texture(&diffuse_tex); free_texture(&normal_tex);
+    for(int i=0; i<6; i++) free_texture(&sky[i]);
+    free(frame_px); free(tris); free(bin_start); free(bin_fill); free(bin_tris); free(tile_bufs); free(layer_sc);
+    frame_px = NULL; tris = NULL; bin_start = bin_fill = bin_tris = NULL; tile_bufs = NULL; layer_sc = NULL;
+    tri_count = tri_cap = bin_cap = layer_cap = 0;
+}
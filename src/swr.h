@@ -0,0 +1,34 @@
+#ifndef SWR_H
+#define SWR_H
+
+// CPU renderer for the single cube, for hosts without a GPU. It draws the same frame as the GL
+// path - stickers, body boxes, skybox, cube.frag lighting and the screen.frag post effects - into
+// an RGBA8 image the caller blits to the window.
+//
+// Triangles are set up and binned into SWR_TILE x SWR_TILE screen tiles on the calling thread;
+// the tiles are then rasterized in parallel by a small worker pool. Each tile owns its depth and
+// colour buffers, so workers never share memory. Edge functions, depth test and shading run four
+// pixels at a time (SSE on x86, NEON on ARM through the compiler's vector extensions) over exact
+// per-row spans of the triangle.
+
+#define SWR_TILE 64
+#define SWR_MAX_THREADS 16
+
+typedef struct {
+    float view[16], proj[16];       // column-major, as passed to the GL programs
+    float view_pos[3], light_pos[3];
+    int n, anim_axis, effect;       // effect: screen.frag effectType
+    const unsigned char* stickers;  // cube_stickers() layout
+    const float* anim_angles;       // one angle per layer (radians), read when anim_axis >= 0
+} SwrFrame;
+
+// Loads the textures (same files as the GL path) and starts threads-1 workers; threads <= 0
+// uses one per online CPU. -1 when a texture is missing or out of memory.
+int swr_init(int width, int height, int threads, const char* diffuse, const char* normal_map, char** sky_faces);
+// Renders a frame and returns width*height RGBA8 pixels, bottom row first (glTexSubImage2D
+// order). The buffer stays valid until the next call.
+const unsigned char* swr_draw(const SwrFrame* f);
+int swr_threads(void);
+void swr_shutdown(void);
+
+#endif
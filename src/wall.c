@@ -0,0 +1,65 @@
+#include "wall.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+Cube* wall = NULL; int wall_count = 0; float wall_extent = 0.0f;
+static int wall_cols = 0;
+static unsigned int* wall_synced = NULL;
+
+#define WALL_SPACING 4.0f
+
+int wall_init(int count) {
+    wall_free();
+    wall = malloc(sizeof(Cube)*(size_t)count); wall_synced = calloc((size_t)count, sizeof(unsigned int));
+    if(!wall || !wall_synced) { free(wall); free(wall_synced); wall = NULL; wall_synced = NULL; return -1; }
+    for(int i=0; i<count; i++) {
+        if(cube_init(&wall[i], WALL_CUBE_N) != 0) {
+            while(i-- > 0) cube_free(&wall[i]);
+            free(wall); free(wall_synced); wall = NULL; wall_synced = NULL; return -1;
+        }
+        cube_shuffle(&wall[i], 5 + rand()%25);
+    }
+    wall_count = count;
+    wall_cols = (int)ceilf(sqrtf((float)count));
+    wall_extent = wall_cols*WALL_SPACING;
+    return 0;
+}
+
+void wall_free() {
+    for(int i=0; i<wall_count; i++) cube_free(&wall[i]);
+    free(wall); free(wall_synced); wall = NULL; wall_synced = NULL; wall_count = 0; }
+
+void wall_step() {
+    for(int i=0; i<wall_count; i++) {
+        Cube* c = &wall[i];
+        if(cube_step(c) & CUBE_EV_IDLE) {
+            if(c->history.count>0) cube_solve(c);
+            else cube_shuffle(c, 10 + rand()%20);
+        }
+    }
+}
+
+int wall_build(CubieInstance* out, WallAnim* anim, int* dirty_from, int* dirty_to) {
+    int n = 0; float half = (wall_cols-1)*WALL_SPACING*0.5f;
+    *dirty_from = *dirty_to = 0;
+    for(int i=0; i<wall_count; i++) {
+        const Cube* c = &wall[i];
+        anim[i].axis = c->anim_moves ? (float)(c->anim_axis - 'x') : -1.0f;
+        for(int l=0; l<WALL_CUBE_N; l++) anim[i].angle[l] = c->anim_moves ? glm_rad(c->anim_angle*c->anim_turns[l]) : 0.0f;
+        if(wall_synced[i] == c->view_version) { n += c->count; continue; }
+        if(*dirty_to == *dirty_from) *dirty_from = n;
+        vec3 offset = { (i%wall_cols)*WALL_SPACING - half, half - (i/wall_cols)*WALL_SPACING, 0.0f };
+        for(int s=0; s<c->count; s++) {
+            memcpy(out[n].offset, offset, sizeof(out[n].offset));
+            memcpy(out[n].cell, c->view_layout.pos[s], 3); out[n].cell[3] = c->view_layout.orient[s];
+            const unsigned char* f = c->cubies[s].faces;
+            out[n].faces = f[0] | f[1]<<3 | f[2]<<6 | f[3]<<9 | f[4]<<12 | f[5]<<15;
+            out[n].cube = (unsigned int)i;
+            n++;
+        }
+        wall_synced[i] = c->view_version; *dirty_to = n;
+    }
+    return n;
+}
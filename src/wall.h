@@ -0,0 +1,27 @@
+#ifndef WALL_H
+#define WALL_H
+
+#include "cube.h"
+
+// "Wall" mode: many independent cubes in one contiguous array, each looping
+// scramble -> solve on its own. Rendering is one instanced draw over all cubies.
+// A cubie instance holds its integer grid cell and orientation, so it only changes when its
+// cube finishes a turn; the turn in progress is a per-cube WallAnim that cube.vert applies.
+
+#define WALL_CUBE_N 3
+
+typedef struct { float offset[3]; unsigned char cell[4]; unsigned int faces, cube; } CubieInstance;  // cell: x, y, z, orientation; faces: 3 bits of palette index per face
+typedef struct { float axis, angle[WALL_CUBE_N]; } WallAnim;  // axis -1 when idle, angle per layer in radians
+
+extern Cube* wall; extern int wall_count; extern float wall_extent;
+
+// -1 when out of memory; the wall is then empty.
+int wall_init(int count);
+void wall_free();
+void wall_step();
+// Fills anim for every cube and rewrites the instances of cubes whose view layout changed
+// since the last call; [*dirty_from, *dirty_to) is the instance range that needs uploading.
+// Returns the total instance count.
+int wall_build(CubieInstance* out, WallAnim* anim, int* dirty_from, int* dirty_to);
+
+#endif